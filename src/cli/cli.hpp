@@ -25,6 +25,34 @@ namespace cli {
         int bits = -1;
         std::string out_pub  = "rsa_key.pub";
         std::string out_priv = "rsa_key";
+
+        // tryb masowy: `--count N --jobs J [--out-dir <dir> | --container <file>]`
+        int count = 1;
+        int jobs  = 0; // 0 -> liczba rdzeni
+        int threads = 0; // wątki szukające p i q dla jednej pary (0 -> liczba rdzeni)
+        std::string primality = "mr"; // test pierwszości: `mr` (Miller-Rabin) lub `bpsw` (Baillie-PSW)
+        int mr_rounds = 25;           // rundy Millera-Rabina (0 -> dobierane do długości liczby)
+        int primes = 2;               // liczba czynników pierwszych n (3-4: klucz wieloczynnikowy, szybsze deszyfrowanie)
+        std::string out_dir;
+        std::string container;
+        std::string pool_dir; // katalog puli liczb pierwszych (`--pool <dir>`, zob. `./rsa pool`)
+    };
+
+    // `./rsa pool <args>` - dopełnienie puli liczb pierwszych dla kluczy `bits`-bitowych
+    struct pool_args_t {
+        int bits = -1;
+        int primes = 2; // liczba czynników kluczy, dla których są liczby (długość bits / primes)
+        std::string dir = ".";
+        int capacity = 64;
+        int jobs = 0; // 0 -> liczba rdzeni
+    };
+
+    // `./rsa keys upgrade <args>` - dopisanie parametrów CRT do starego klucza `d n`
+    struct keys_args_t {
+        std::string action;                     // `upgrade`
+        std::string priv_key_path = "rsa_key";
+        std::string pub_key_path;               // klucz publiczny (z niego e); brak -> e = 65537
+        std::string out_file;                   // domyślnie nadpisywany jest plik --priv
     };
 
     // `./rsa encrypt <args>`
@@ -34,6 +62,9 @@ namespace cli {
 
         std::string in_file; // ścieżka do pliku (który chcemy zaszyfrować)
         std::string input;   // lub wiadomość podana przez -m "<input>"
+
+        std::string framing = "legacy"; // podział na bloki: `legacy` lub `fixed` (k-1 bajtów + długość)
+        bool binary = false;            // kontener binarny (nagłówek + bloki po k bajtów) zamiast liczb dziesiętnych
     };
 
     // `./rsa decrypt <args>`
@@ -43,6 +74,9 @@ namespace cli {
 
         std::string in_file; // ścieżka do pliku (który chcemy odszyfrować)
         std::string input;   // lub wiadomość podana przez -m "<input>"
+
+        bool latency = false; // połówki CRT każdego bloku liczone naraz na dwóch rdzeniach
+        std::string framing = "legacy"; // musi być taki sam jak przy szyfrowaniu (kontener binarny zapisuje go sam)
     };
 
     class CLI {
@@ -52,8 +86,10 @@ namespace cli {
         genkeys_args_t _genkeys_args;
         encrypt_args_t _encrypt_args;
         decrypt_args_t _decrypt_args;
+        pool_args_t    _pool_args;
+        keys_args_t    _keys_args;
 
-        enum class Command { NONE, GENKEYS, ENCRYPT, DECRYPT, HELP };
+        enum class Command { NONE, GENKEYS, ENCRYPT, DECRYPT, POOL, KEYS, HELP };
         Command selected_cmd = Command::NONE;
 
         lyra::cli parser;
@@ -61,11 +97,15 @@ namespace cli {
         lyra::command cmd_genkeys;
         lyra::command cmd_encrypt;
         lyra::command cmd_decrypt;
+        lyra::command cmd_pool;
+        lyra::command cmd_keys;
 
         CLI()
             : cmd_genkeys("genkeys", [&](lyra::group const&) { selected_cmd = Command::GENKEYS; }),
               cmd_encrypt("encrypt", [&](lyra::group const&) { selected_cmd = Command::ENCRYPT; }),
-              cmd_decrypt("decrypt", [&](lyra::group const&) { selected_cmd = Command::DECRYPT; })
+              cmd_decrypt("decrypt", [&](lyra::group const&) { selected_cmd = Command::DECRYPT; }),
+              cmd_pool("pool", [&](lyra::group const&) { selected_cmd = Command::POOL; }),
+              cmd_keys("keys", [&](lyra::group const&) { selected_cmd = Command::KEYS; })
         {
             cmd_genkeys
                 .help("Generate RSA key-pair")
@@ -80,8 +120,84 @@ namespace cli {
                 .add_argument(lyra::opt(_genkeys_args.out_priv, "file")
                     .name("--priv")
                     .help("Output private key file"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.threads, "t")
+                    .name("--threads").name("-t")
+                    .help("Threads racing on the p/q prime search of a single key (default: all cores)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.primality, "mr|bpsw")
+                    .name("--primality")
+                    .help("Primality test for prime candidates: Miller-Rabin or Baillie-PSW (default: mr)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.mr_rounds, "rounds")
+                    .name("--mr-rounds")
+                    .help("Miller-Rabin rounds, 0 = minimal count for the candidate size (default: 25)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.primes, "k")
+                    .name("--primes")
+                    .help("Number of prime factors of n: 2, 3 or 4 (multi-prime RSA, default: 2)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.count, "n")
+                    .name("--count").name("-n")
+                    .help("Number of key pairs to generate (default: 1)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.jobs, "j")
+                    .name("--jobs").name("-j")
+                    .help("Worker threads for bulk generation (default: all cores)"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.out_dir, "dir")
+                    .name("--out-dir")
+                    .help("Output directory for bulk key files"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.container, "file")
+                    .name("--container")
+                    .help("Write all key pairs into a single container file"))
+                    .optional()
+                .add_argument(lyra::opt(_genkeys_args.pool_dir, "dir")
+                    .name("--pool")
+                    .help("Take p and q from the prime pool in <dir> when it has stock"))
                     .optional();
 
+            cmd_pool
+                .help("Fill the shared prime pool used by `genkeys --pool`")
+                .add_argument(lyra::opt(_pool_args.bits, "bits")
+                    .name("--bits").name("-b")
+                    .help("Key size in bits the primes are meant for"))
+                .add_argument(lyra::opt(_pool_args.primes, "k")
+                    .optional()
+                    .name("--primes")
+                    .help("Number of prime factors of those keys: 2, 3 or 4 (default: 2)"))
+                .add_argument(lyra::opt(_pool_args.dir, "dir")
+                    .optional()
+                    .name("--dir")
+                    .help("Pool directory (default: .)"))
+                .add_argument(lyra::opt(_pool_args.capacity, "n")
+                    .optional()
+                    .name("--capacity")
+                    .help("Number of primes kept in a newly created pool (default: 64)"))
+                .add_argument(lyra::opt(_pool_args.jobs, "j")
+                    .optional()
+                    .name("--jobs").name("-j")
+                    .help("Worker threads filling the pool (default: all cores)"));
+
+            cmd_keys
+                .help("Maintain existing key files (`keys upgrade`: add CRT parameters to a `d n` private key)")
+                .add_argument(lyra::arg(_keys_args.action, "action")
+                    .required()
+                    .help("upgrade"))
+                .add_argument(lyra::opt(_keys_args.priv_key_path, "file")
+                    .optional()
+                    .name("-k").name("--priv")
+                    .help("Private key file (default: rsa_key)"))
+                .add_argument(lyra::opt(_keys_args.pub_key_path, "file")
+                    .optional()
+                    .name("--pub")
+                    .help("Matching public key file (default: assume e = 65537)"))
+                .add_argument(lyra::opt(_keys_args.out_file, "file")
+                    .optional()
+                    .name("--out")
+                    .help("Output file (default: rewrite the private key file)"));
+
             cmd_encrypt
                 .help("Encrypt a file or a message")
                 .add_argument(lyra::opt(_encrypt_args.pub_key_path, "path")
@@ -95,6 +211,14 @@ namespace cli {
                     .optional()
                     .name("--message").name("-m")
                     .help("Raw text to encrypt"))
+                .add_argument(lyra::opt(_encrypt_args.framing, "legacy|fixed")
+                    .optional()
+                    .name("--framing")
+                    .help("Block framing: legacy or fixed (k-1 bytes per block + length trailer, default: legacy)"))
+                .add_argument(lyra::opt(_encrypt_args.binary)
+                    .optional()
+                    .name("--binary")
+                    .help("Write a binary container (header + fixed-width blocks) instead of decimal numbers; needs --out"))
                 .add_argument(lyra::arg(_encrypt_args.in_file, "input_file")
                     .optional()
                     .help("File path of a file to encrypt"));
@@ -112,6 +236,14 @@ namespace cli {
                     .optional()
                     .name("--message").name("-m")
                     .help("Raw text to decrypt"))
+                .add_argument(lyra::opt(_decrypt_args.latency)
+                    .optional()
+                    .name("--latency")
+                    .help("Low-latency mode: run both CRT halves of each block in parallel"))
+                .add_argument(lyra::opt(_decrypt_args.framing, "legacy|fixed")
+                    .optional()
+                    .name("--framing")
+                    .help("Block framing used at encryption: legacy or fixed (default: legacy; binary containers store it)"))
                 .add_argument(lyra::arg(_decrypt_args.in_file, "input_file")
                     .optional()
                     .help("File path of a file to decrypt"));
@@ -120,6 +252,8 @@ namespace cli {
             parser.add_argument(cmd_genkeys);
             parser.add_argument(cmd_encrypt);
             parser.add_argument(cmd_decrypt);
+            parser.add_argument(cmd_pool);
+            parser.add_argument(cmd_keys);
         }
 
         bool parse(int argc, char* argv[]) {
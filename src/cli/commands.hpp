@@ -1,20 +1,32 @@
 #ifndef CMD_H
 #define CMD_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cli.hpp"
 #include "../rsa/rsa.h"
+#include "../rsa/cipher_container.h"
 
 namespace fs = std::filesystem;
 
 using rsa::RSA;
+using rsa::PrimalityTest;
+using rsa::Framing;
+using rsa::PrimePool;
 using rsa::PubKey;
 using rsa::PrivKey;
 using rsa::big_int;
@@ -52,7 +64,201 @@ namespace cli {
         }
     }
 
-    // ./rsa genkeys --bits <bits> --pub <pubfile> --priv <privfile>
+    // Dane binarne bez dopisywania '\n' i nigdy na konsolę
+    static inline void write_binary_output(const std::string& path, const std::string& content) {
+        if (path.empty()) throw std::runtime_error("Input error: binary output needs --out <file>.");
+
+        std::ofstream ofs(path, std::ios::binary);
+        if (!ofs) throw std::runtime_error("Failed to save file: " + path);
+        ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!ofs.flush()) throw std::runtime_error("Failed to save file: " + path);
+
+        std::cout << "saved result to " << path << "\n";
+    }
+
+    /* Format pliku klucza prywatnego: `d n [p q dP dQ qInv [r d_r t_r]...]`
+     * Parametry CRT są opcjonalne - starsze pliki `d n` nadal działają (bez przyspieszenia CRT).
+     * Klucz wieloczynnikowy dopisuje w tej samej linii trójki (czynnik, wykładnik, współczynnik Garnera). */
+    static inline void write_priv_key(std::ostream& os, const PrivKey& priv) {
+        os << fmt_big_int(priv.d) << " " << fmt_big_int(priv.n);
+        if (priv.has_crt()) {
+            os << " " << fmt_big_int(priv.p)  << " " << fmt_big_int(priv.q)
+               << " " << fmt_big_int(priv.dP) << " " << fmt_big_int(priv.dQ)
+               << " " << fmt_big_int(priv.qInv);
+            for (const auto& o : priv.others) {
+                os << " " << fmt_big_int(o.r) << " " << fmt_big_int(o.d) << " " << fmt_big_int(o.t);
+            }
+        }
+        os << "\n";
+    }
+
+    static inline PrivKey read_priv_key(std::istream& is) {
+        PrivKey priv;
+        if (!(is >> priv.d >> priv.n)) {
+            throw std::runtime_error("Wrong private key file format (expected: d n [p q dP dQ qInv [r d t]...]).");
+        }
+
+        PrivKey crt = priv;
+        if (is >> crt.p >> crt.q >> crt.dP >> crt.dQ >> crt.qInv) {
+            // Reszta linii: trójki kolejnych czynników
+            std::string rest;
+            std::getline(is, rest);
+            std::istringstream extra(rest);
+            big_int product = crt.p * crt.q;
+            rsa::OtherPrimeInfo other;
+            while (extra >> other.r) {
+                if (!(extra >> other.d >> other.t) || crt.others.size() + 2 >= rsa::max_key_primes) {
+                    throw std::runtime_error("Wrong private key file format (incomplete or too many extra primes).");
+                }
+                product *= other.r;
+                crt.others.push_back(other);
+            }
+            if (product != crt.n) {
+                throw std::runtime_error("Wrong private key file format (CRT parameters do not match n).");
+            }
+            return crt;
+        }
+        return priv;
+    }
+
+    static inline void write_pub_key(std::ostream& os, const PubKey& pub) {
+        os << fmt_big_int(pub.e) << " " << fmt_big_int(pub.n) << "\n";
+    }
+
+    // rsa_key.pub + 7 -> rsa_key_7.pub (opcjonalnie w katalogu dir)
+    static inline fs::path indexed_path(const std::string& base, size_t index, const std::string& dir) {
+        fs::path p(base);
+        fs::path name = p.stem().string() + "_" + std::to_string(index) + p.extension().string();
+        return dir.empty() ? p.parent_path() / name : fs::path(dir) / name;
+    }
+
+    // `--primality mr|bpsw` -> rsa::PrimalityTest
+    inline PrimalityTest parse_primality(const std::string& name) {
+        if (name == "mr") return PrimalityTest::MillerRabin;
+        if (name == "bpsw") return PrimalityTest::BailliePSW;
+        throw std::runtime_error("Input error: --primality must be `mr` or `bpsw`, got " + name);
+    }
+
+    // `--framing legacy|fixed` -> rsa::Framing
+    inline Framing parse_framing(const std::string& name) {
+        if (name == "legacy") return Framing::Legacy;
+        if (name == "fixed") return Framing::Fixed;
+        throw std::runtime_error("Input error: --framing must be `legacy` or `fixed`, got " + name);
+    }
+
+    /* Długość liczb pierwszych w puli dla kluczy `key_bits`-bitowych o `primes` czynnikach.
+     * Pula ma jedną długość, więc wszystkie czynniki z RSA::prime_sizes muszą być równe -
+     * inaczej ostatni zawsze omijałby pulę */
+    inline unsigned int pool_prime_bits(int key_bits, int primes) {
+        const auto sizes = RSA::prime_sizes(static_cast<unsigned int>(key_bits), static_cast<unsigned int>(primes));
+        if (std::adjacent_find(sizes.begin(), sizes.end(), std::not_equal_to<>()) != sizes.end()) {
+            throw std::runtime_error("Input error: --pool needs --bits divisible by --primes, got "
+                                     + std::to_string(key_bits) + " / " + std::to_string(primes));
+        }
+        return sizes.front();
+    }
+
+    // Pula liczb pierwszych dla kluczy `key_bits`-bitowych o `primes` czynnikach w katalogu `dir`
+    inline std::shared_ptr<PrimePool> open_prime_pool(const std::string& dir, int key_bits, int primes,
+                                                      size_t capacity = rsa::prime_pool_default_capacity) {
+        const unsigned int bits = pool_prime_bits(key_bits, primes);
+        fs::create_directories(dir);
+        return std::make_shared<PrimePool>(PrimePool::default_path(dir, bits), bits, capacity);
+    }
+
+    /* Jedna para trybu masowego o indeksie i z rsa_engine: do osobnych plików w args.out_dir
+     * albo - gdy container != nullptr - jako linia klucza publicznego i linia prywatnego pod out_mutex */
+    inline void generate_bulk_entry(RSA& rsa_engine, const genkeys_args_t& args, size_t i,
+                                    std::ostream* container, std::mutex& out_mutex) {
+        rsa_engine.generate_keys(static_cast<unsigned int>(args.bits), static_cast<unsigned int>(args.mr_rounds));
+        const auto pub  = rsa_engine.get_public_key();
+        const auto priv = rsa_engine.get_private_key();
+
+        if (container) {
+            std::ostringstream entry;
+            write_pub_key(entry, pub);
+            write_priv_key(entry, priv);
+            std::lock_guard lock(out_mutex);
+            *container << entry.str();
+            return;
+        }
+
+        std::ofstream pub_file(indexed_path(args.out_pub, i, args.out_dir));
+        std::ofstream priv_file(indexed_path(args.out_priv, i, args.out_dir));
+        if (!pub_file || !priv_file) {
+            throw std::runtime_error("Filesystem error: unable to create key files.");
+        }
+        write_pub_key(pub_file, pub);
+        write_priv_key(priv_file, priv);
+    }
+
+    /* Tryb masowy: N par kluczy na puli J wątków.
+     * Każda para trafia od razu do katalogu (osobne pliki) albo do jednego kontenera,
+     * w którym zapisane są kolejno linia klucza publicznego i linia klucza prywatnego.
+     * --threads dotyczy jednej pary; 0 dzieli rdzenie między J wątków puli. */
+    inline bool cmd_generate_keys_bulk(const genkeys_args_t& args) {
+        const size_t count = static_cast<size_t>(args.count);
+        const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        unsigned int jobs = args.jobs > 0 ? static_cast<unsigned int>(args.jobs) : cores;
+        jobs = static_cast<unsigned int>(std::min<size_t>(jobs, count));
+        const unsigned int threads = args.threads > 0 ? static_cast<unsigned int>(args.threads)
+                                                      : std::max(1u, cores / jobs);
+
+        if (!args.out_dir.empty()) fs::create_directories(args.out_dir);
+
+        std::ofstream container;
+        if (!args.container.empty()) {
+            container.open(args.container);
+            if (!container) {
+                throw std::runtime_error("Filesystem error: unable to create key container file.");
+            }
+        }
+
+        std::shared_ptr<PrimePool> pool;
+        if (!args.pool_dir.empty()) pool = open_prime_pool(args.pool_dir, args.bits, args.primes);
+
+        std::mutex out_mutex;
+        std::atomic<size_t> next{ 0 };
+        std::exception_ptr error;
+
+        auto worker = [&] {
+            RSA rsa_engine;
+            rsa_engine.set_keygen_threads(threads);
+            rsa_engine.set_primality_test(parse_primality(args.primality));
+            rsa_engine.set_prime_count(static_cast<unsigned int>(args.primes));
+            rsa_engine.attach_prime_pool(pool);
+            for (size_t i = next++; i < count; i = next++) {
+                try {
+                    generate_bulk_entry(rsa_engine, args, i, container.is_open() ? &container : nullptr, out_mutex);
+                } catch (...) {
+                    std::lock_guard lock(out_mutex);
+                    if (!error) error = std::current_exception();
+                    next = count; // przerwij pozostałe wątki
+                }
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> pool;
+            for (unsigned int t = 0; t < jobs; ++t) pool.emplace_back(worker);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (error) std::rethrow_exception(error);
+        if (container.is_open() && !container.flush()) {
+            throw std::runtime_error("Filesystem error: unable to write key container file.");
+        }
+
+        std::cout << "generated " << count << " key pairs (" << args.bits << " bits) on "
+                  << jobs << " x " << threads << " threads in " << elapsed.count() << " s ("
+                  << (elapsed.count() > 0 ? count / elapsed.count() : 0.0) << " keys/s)\n";
+        std::cout << "out:  " << (container.is_open() ? args.container
+                                  : (args.out_dir.empty() ? std::string(".") : args.out_dir)) << "\n";
+        return true;
+    }
+
+    // ./rsa genkeys --bits <bits> --pub <pubfile> --priv <privfile> [--primes K] [--count N --jobs J --out-dir <dir> | --container <file>] [--pool <dir>]
     inline bool cmd_generate_keys(genkeys_args_t& args) {
         if (args.bits == -1) {
             std::cout << "key bits size not provided. please provide your desired key bits size (min. 32): ";
@@ -65,8 +271,23 @@ namespace cli {
             throw std::runtime_error("Input error: RSA requires at least 32-bit key, got " + std::to_string(args.bits));
         }
 
+        if (args.count < 1 || args.jobs < 0 || args.threads < 0 || args.mr_rounds < 0) {
+            throw std::runtime_error("Input error: --count must be >= 1, --jobs, --threads and --mr-rounds >= 0.");
+        }
+        parse_primality(args.primality);
+        if (args.primes < 2 || args.primes > static_cast<int>(rsa::max_key_primes)) {
+            throw std::runtime_error("Input error: --primes must be 2, 3 or 4, got " + std::to_string(args.primes));
+        }
+        if (args.count > 1 || !args.out_dir.empty() || !args.container.empty()) {
+            return cmd_generate_keys_bulk(args);
+        }
+
         RSA rsa_engine;
-        rsa_engine.generate_keys(static_cast<unsigned int>(args.bits));
+        rsa_engine.set_keygen_threads(static_cast<unsigned int>(args.threads));
+        rsa_engine.set_primality_test(parse_primality(args.primality));
+        rsa_engine.set_prime_count(static_cast<unsigned int>(args.primes));
+        if (!args.pool_dir.empty()) rsa_engine.attach_prime_pool(open_prime_pool(args.pool_dir, args.bits, args.primes));
+        rsa_engine.generate_keys(static_cast<unsigned int>(args.bits), static_cast<unsigned int>(args.mr_rounds));
 
         const auto pub  = rsa_engine.get_public_key();
         const auto priv = rsa_engine.get_private_key();
@@ -76,7 +297,7 @@ namespace cli {
             if (!pub_file) {
                 throw std::runtime_error("Filesystem error: unable to create public key file.");
             }
-            pub_file << fmt_big_int(pub.e) << " " << fmt_big_int(pub.n) << "\n";
+            write_pub_key(pub_file, pub);
         }
 
         {
@@ -84,7 +305,7 @@ namespace cli {
             if (!priv_file) {
                 throw std::runtime_error("Filesystem error: unable to create private key file.");
             }
-            priv_file << fmt_big_int(priv.d) << " " << fmt_big_int(priv.n) << "\n";
+            write_priv_key(priv_file, priv);
         }
 
         std::cout << "pub:  " << args.out_pub  << "\n";
@@ -92,7 +313,40 @@ namespace cli {
         return true;
     }
 
-    // ./rsa encrypt --pub <pubfile> [--out <outfile>] [-m "<text>" | <input_file>]
+    // ./rsa pool --bits <bits> [--primes K] [--dir <dir>] [--capacity N] [--jobs J]
+    inline bool cmd_fill_pool(const pool_args_t& args) {
+        if (args.bits < 32 || args.capacity < 1 || args.jobs < 0) {
+            throw std::runtime_error("Input error: --bits must be >= 32, --capacity >= 1 and --jobs >= 0.");
+        }
+        if (args.primes < 2 || args.primes > static_cast<int>(rsa::max_key_primes)) {
+            throw std::runtime_error("Input error: --primes must be 2, 3 or 4, got " + std::to_string(args.primes));
+        }
+        unsigned int jobs = args.jobs > 0 ? static_cast<unsigned int>(args.jobs)
+                                           : std::max(1u, std::thread::hardware_concurrency());
+
+        auto pool = open_prime_pool(args.dir, args.bits, args.primes, static_cast<size_t>(args.capacity));
+        const size_t before = pool->size();
+
+        /* Koniec, gdy pula jest pełna albo ten proces dołożył tyle, ile brakowało na starcie -
+         * inny proces zdejmujący liczby równie szybko nie zatrzyma `pool` w nieskończoność */
+        const size_t wanted = pool->capacity() > before ? pool->capacity() - before : 0;
+        const auto start = std::chrono::steady_clock::now();
+        RSA rsa_engine;
+        rsa_engine.start_pool_refill(*pool, jobs);
+        while (pool->size() < pool->capacity() && pool->refill_added() < wanted && !pool->refill_error()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        pool->stop_refill();
+        if (auto error = pool->refill_error()) std::rethrow_exception(error);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "pool: " << PrimePool::default_path(args.dir, pool->bits()).string() << " ("
+                  << pool->size() << "/" << pool->capacity() << " primes of " << pool->bits() << " bits, "
+                  << pool->refill_added() << " added in " << elapsed.count() << " s)\n";
+        return true;
+    }
+
+    // ./rsa encrypt --pub <pubfile> [--out <outfile>] [--framing legacy|fixed] [--binary] [-m "<text>" | <input_file>]
     inline bool cmd_encrypt(encrypt_args_t& args) {
         std::ifstream key_file(args.pub_key_path);
         if (!key_file) {
@@ -114,8 +368,14 @@ namespace cli {
         }
 
         RSA rsa_engine;
+        rsa_engine.set_framing(parse_framing(args.framing));
         auto encrypted_blocks = rsa_engine.encrypt_string(raw_input, pub);
 
+        if (args.binary) {
+            write_binary_output(args.out_file, rsa::pack_cipher_blocks(encrypted_blocks, pub.n, rsa_engine.framing()));
+            return true;
+        }
+
         std::ostringstream oss;
         for (const auto& blk : encrypted_blocks) {
             oss << fmt_big_int(blk) << " ";
@@ -125,17 +385,79 @@ namespace cli {
         return true;
     }
 
-    // ./rsa decrypt --priv <privfile> [--out <outfile>] [-m "<cipher numbers>" | <input_file>]
+    // ./rsa keys upgrade [--priv <privfile>] [--pub <pubfile>] [--out <outfile>]
+    inline bool cmd_keys(const keys_args_t& args) {
+        if (args.action != "upgrade") {
+            throw std::runtime_error("Input error: unknown keys action `" + args.action + "` (expected: upgrade).");
+        }
+
+        PrivKey priv;
+        {
+            std::ifstream key_file(args.priv_key_path);
+            if (!key_file) {
+                throw std::runtime_error("Missing private key file: " + args.priv_key_path);
+            }
+            priv = read_priv_key(key_file);
+        }
+        if (priv.has_crt()) {
+            std::cout << "priv: " << args.priv_key_path << " already has CRT parameters\n";
+            return true;
+        }
+
+        big_int e = 65537;
+        if (!args.pub_key_path.empty()) {
+            std::ifstream pub_file(args.pub_key_path);
+            PubKey pub;
+            if (!pub_file || !(pub_file >> pub.e >> pub.n)) {
+                throw std::runtime_error("Wrong public key file format (expected: e n).");
+            }
+            if (pub.n != priv.n) {
+                throw std::runtime_error("Public key does not match the private key (different n).");
+            }
+            e = pub.e;
+        }
+
+        RSA rsa_engine;
+        const PrivKey upgraded = rsa_engine.recover_crt(priv, e);
+
+        /* Zapis do pliku tymczasowego i podmiana - przerwany zapis nie niszczy klucza.
+         * Plik tymczasowy jest od początku tylko dla właściciela, a przed podmianą dostaje
+         * uprawnienia starego klucza; po błędzie jest usuwany */
+        const fs::path out = args.out_file.empty() ? fs::path(args.priv_key_path) : fs::path(args.out_file);
+        const fs::path tmp = out.string() + ".tmp";
+        const fs::perms key_perms = fs::status(args.priv_key_path).permissions();
+        try {
+            {
+                std::ofstream priv_file(tmp);
+                if (!priv_file) {
+                    throw std::runtime_error("Filesystem error: unable to create private key file.");
+                }
+                fs::permissions(tmp, fs::perms::owner_read | fs::perms::owner_write);
+                write_priv_key(priv_file, upgraded);
+                if (!priv_file.flush()) {
+                    throw std::runtime_error("Filesystem error: unable to write private key file.");
+                }
+            }
+            fs::permissions(tmp, key_perms);
+            fs::rename(tmp, out);
+        } catch (...) {
+            std::error_code ignored;
+            fs::remove(tmp, ignored);
+            throw;
+        }
+
+        std::cout << "priv: " << out.string() << " (upgraded with CRT parameters)\n";
+        return true;
+    }
+
+    // ./rsa decrypt --priv <privfile> [--out <outfile>] [--latency] [--framing legacy|fixed] [-m "<cipher numbers>" | <input_file>]
     inline bool cmd_decrypt(const decrypt_args_t& args) {
         std::ifstream key_file(args.priv_key_path);
         if (!key_file) {
             throw std::runtime_error("Missing private key file: " + args.priv_key_path);
         }
 
-        PrivKey priv;
-        if (!(key_file >> priv.d >> priv.n)) {
-            throw std::runtime_error("Wrong private key file format (expected: d n).");
-        }
+        PrivKey priv = read_priv_key(key_file);
 
         std::string raw_input;
         if (!args.input.empty()) {
@@ -146,18 +468,27 @@ namespace cli {
             throw std::runtime_error("No data to decrypt provided: use decrypt -m \"<text>\" OR decrypt <filename>");
         }
 
-        std::stringstream ss(raw_input);
+        RSA rsa_engine;
+        rsa_engine.set_latency_mode(args.latency);
+        rsa_engine.set_framing(parse_framing(args.framing));
+
+        // Kontener binarny rozpoznawany po magic; podział na bloki zapisany w nagłówku
         std::vector<big_int> cipher_blocks;
-        big_int temp;
-        while (ss >> temp) {
-            cipher_blocks.push_back(temp);
-        }
+        if (rsa::is_cipher_container(raw_input)) {
+            rsa::CipherHeader header;
+            cipher_blocks = rsa::unpack_cipher_blocks(raw_input, priv.n, &header);
+            rsa_engine.set_framing(header.framing);
+        } else {
+            std::stringstream ss(raw_input);
+            big_int temp;
+            while (ss >> temp) {
+                cipher_blocks.push_back(temp);
+            }
 
-        if (cipher_blocks.empty()) {
-            throw std::runtime_error("Input did not contain valid numbers.");
+            if (cipher_blocks.empty()) {
+                throw std::runtime_error("Input did not contain valid numbers.");
+            }
         }
-
-        RSA rsa_engine;
         std::string decrypted = rsa_engine.decrypt_string(cipher_blocks, priv);
 
         write_output(args.out_file, decrypted);
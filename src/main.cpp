@@ -34,6 +34,12 @@ int main(int argc, char* argv[]) {
             case CLI::Command::DECRYPT:
                 cli::cmd_decrypt(cli._decrypt_args);
                 break;
+            case CLI::Command::POOL:
+                cli::cmd_fill_pool(cli._pool_args);
+                break;
+            case CLI::Command::KEYS:
+                cli::cmd_keys(cli._keys_args);
+                break;
             default:
                 std::cout << cli.parser << "\n";
                 break;
@@ -51,6 +57,12 @@ int main(int argc, char* argv[]) {
             case CLI::Command::DECRYPT:
                 std::cout << cli.cmd_decrypt << '\n';
                 break;
+            case CLI::Command::POOL:
+                std::cout << cli.cmd_pool << '\n';
+                break;
+            case CLI::Command::KEYS:
+                std::cout << cli.cmd_keys << '\n';
+                break;
             default:
                 std::cout << cli.parser << '\n';
                 break;
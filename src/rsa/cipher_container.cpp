@@ -0,0 +1,106 @@
+#include "cipher_container.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace rsa {
+    static constexpr char cipher_magic[8] = { 'R', 'S', 'A', 'C', 'I', 'P', 'H', '1' };
+
+    static constexpr std::uint64_t fnv_offset = 0xcbf29ce484222325ull;
+    static constexpr std::uint64_t fnv_prime = 0x100000001b3ull;
+
+    static size_t byte_length(const big_int& n) {
+        return mpz_sgn(n.get_mpz_t()) == 0 ? 0 : (mpz_sizeinbase(n.get_mpz_t(), 2) + 7) / 8;
+    }
+
+    // Pole `bytes` bajtów big-endian od pozycji pos
+    static void put_be(std::string& out, size_t pos, std::uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) out[pos + i] = static_cast<char>(value >> (8 * (bytes - 1 - i)) & 0xff);
+    }
+
+    static std::uint64_t get_be(std::string_view data, size_t pos, size_t bytes) {
+        std::uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) value = value << 8 | static_cast<unsigned char>(data[pos + i]);
+        return value;
+    }
+
+    std::uint64_t key_fingerprint(const big_int& n) {
+        std::string bytes(byte_length(n), '\0');
+        if (!bytes.empty()) mpz_export(bytes.data(), nullptr, 1, 1, 1, 0, n.get_mpz_t());
+
+        std::uint64_t hash = fnv_offset;
+        for (char c : bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= fnv_prime;
+        }
+        return hash;
+    }
+
+    bool is_cipher_container(std::string_view data) {
+        return data.size() >= sizeof(cipher_magic) && data.substr(0, sizeof(cipher_magic)) == std::string_view(cipher_magic, sizeof(cipher_magic));
+    }
+
+    std::string pack_cipher_blocks(std::span<const big_int> blocks, const big_int& n, Framing framing) {
+        const size_t k = byte_length(n);
+        if (k == 0) throw std::runtime_error("Public key not set (n==0).");
+
+        // Jedna alokacja na cały plik; bloki wyrównane do prawej w wyzerowanych slotach
+        std::string out(cipher_header_bytes + blocks.size() * k, '\0');
+        std::copy(std::begin(cipher_magic), std::end(cipher_magic), out.begin());
+        put_be(out, 8, cipher_format_version, 2);
+        put_be(out, 10, static_cast<std::uint64_t>(framing), 1);
+        put_be(out, 12, k, 4);
+        put_be(out, 16, key_fingerprint(n), 8);
+        put_be(out, 24, blocks.size(), 8);
+
+        char* slot = out.data() + cipher_header_bytes;
+        for (const big_int& c : blocks) {
+            if (c < 0 || c >= n) throw std::runtime_error("Ciphertext block out of range (<0 or >= n).");
+            const size_t bytes = byte_length(c);
+            if (bytes > 0) mpz_export(slot + k - bytes, nullptr, 1, 1, 1, 0, c.get_mpz_t());
+            slot += k;
+        }
+        return out;
+    }
+
+    std::vector<big_int> unpack_cipher_blocks(std::string_view data, const big_int& n, CipherHeader* header) {
+        if (data.size() < cipher_header_bytes || !is_cipher_container(data)) {
+            throw std::runtime_error("Cipher container: missing or truncated header.");
+        }
+
+        CipherHeader h;
+        h.version = static_cast<std::uint16_t>(get_be(data, 8, 2));
+        if (h.version != cipher_format_version) {
+            throw std::runtime_error("Cipher container: unsupported format version " + std::to_string(h.version) + ".");
+        }
+        const std::uint64_t framing = get_be(data, 10, 1);
+        if (framing > static_cast<std::uint64_t>(Framing::Fixed)) {
+            throw std::runtime_error("Cipher container: unknown block framing.");
+        }
+        h.framing = static_cast<Framing>(framing);
+        if (get_be(data, 11, 1) != 0) {
+            throw std::runtime_error("Cipher container: non-zero reserved header byte.");
+        }
+        h.modulus_bytes = static_cast<std::uint32_t>(get_be(data, 12, 4));
+        h.fingerprint = get_be(data, 16, 8);
+        h.block_count = get_be(data, 24, 8);
+
+        const size_t k = byte_length(n);
+        if (h.modulus_bytes != k || h.fingerprint != key_fingerprint(n)) {
+            throw std::runtime_error("Cipher container: ciphertext was encrypted for a different key.");
+        }
+        if (k == 0 || h.block_count > (data.size() - cipher_header_bytes) / k
+            || cipher_header_bytes + h.block_count * k != data.size()) {
+            throw std::runtime_error("Cipher container: data length does not match the header.");
+        }
+
+        std::vector<big_int> blocks(h.block_count);
+        const char* slot = data.data() + cipher_header_bytes;
+        for (big_int& c : blocks) {
+            mpz_import(c.get_mpz_t(), k, 1, 1, 1, 0, slot);
+            slot += k;
+        }
+
+        if (header) *header = h;
+        return blocks;
+    }
+}
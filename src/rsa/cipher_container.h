@@ -0,0 +1,47 @@
+#ifndef CIPHER_CONTAINER_H
+#define CIPHER_CONTAINER_H
+
+#include <gmpxx.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rsa.h"
+
+namespace rsa {
+    /* Binarny zapis szyfrogramu zamiast liczb dziesietnych oddzielonych spacjami.
+     *
+     * Uklad (wszystkie pola big-endian, naglowek cipher_header_bytes = 32 bajty):
+     *   magic "RSACIPH1" (8) | wersja (2) | Framing (1) | zarezerwowane 0 (1)
+     *   | k = dlugosc n w bajtach (4) | odcisk klucza FNV-1a-64 z bajtow n (8) | liczba blokow (8)
+     * potem `liczba blokow` blokow po dokladnie k bajtow big-endian (c < n zawsze sie miesci). */
+    inline constexpr std::uint16_t cipher_format_version = 1;
+    inline constexpr size_t cipher_header_bytes = 32;
+
+    struct CipherHeader {
+        std::uint16_t version = cipher_format_version;
+        Framing framing = Framing::Legacy;
+        std::uint32_t modulus_bytes = 0;
+        std::uint64_t fingerprint = 0;
+        std::uint64_t block_count = 0;
+    };
+
+    // FNV-1a-64 po bajtach n big-endian (bez wiodacych zer) - ten sam dla klucza publicznego i prywatnego
+    std::uint64_t key_fingerprint(const big_int& n);
+
+    // Czy dane zaczynaja sie od magic kontenera (rozpoznanie formatu przy deszyfrowaniu)
+    bool is_cipher_container(std::string_view data);
+
+    // Naglowek i bloki o stalej szerokosci; rzuca std::runtime_error dla bloku spoza [0, n)
+    std::string pack_cipher_blocks(std::span<const big_int> blocks, const big_int& n, Framing framing);
+
+    /* Bloki z kontenera dla klucza o module n. Rzuca std::runtime_error przy zlym magic, wersji,
+     * niezerowym bajcie zarezerwowanym, innym kluczu (odcisk, k) i dlugosci danych niezgodnej
+     * z naglowkiem. header - opcjonalnie naglowek */
+    std::vector<big_int> unpack_cipher_blocks(std::string_view data, const big_int& n, CipherHeader* header = nullptr);
+}
+
+#endif
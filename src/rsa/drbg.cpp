@@ -0,0 +1,133 @@
+#include "drbg.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/random.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <bcrypt.h>
+#else
+#include <random>
+#endif
+
+namespace rsa {
+    void os_entropy(void* out, size_t len) {
+        auto* p = static_cast<std::uint8_t*>(out);
+#if defined(__linux__)
+        while (len > 0) {
+            ssize_t got = getrandom(p, len, 0);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("os_entropy: getrandom() failed.");
+            }
+            p += got;
+            len -= static_cast<size_t>(got);
+        }
+#elif defined(_WIN32)
+        if (BCryptGenRandom(nullptr, p, static_cast<ULONG>(len), BCRYPT_USE_SYSTEM_PREFERRED_RNG) != 0) {
+            throw std::runtime_error("os_entropy: BCryptGenRandom() failed.");
+        }
+#else
+        std::random_device rd;
+        for (size_t i = 0; i < len; ++i) p[i] = static_cast<std::uint8_t>(rd());
+#endif
+    }
+
+    static inline std::uint32_t load32_le(const std::uint8_t* p) {
+        return std::uint32_t(p[0]) | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 24);
+    }
+
+    static inline std::uint32_t rotl(std::uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+    static inline void quarter_round(std::uint32_t& a, std::uint32_t& b, std::uint32_t& c, std::uint32_t& d) {
+        a += b; d ^= a; d = rotl(d, 16);
+        c += d; b ^= c; b = rotl(b, 12);
+        a += b; d ^= a; d = rotl(d, 8);
+        c += d; b ^= c; b = rotl(b, 7);
+    }
+
+    /* Układ stanu: 4 stałe, 8 słów klucza, 64-bitowy licznik bloków (słowa 12-13)
+     * i 64-bitowy nonce (słowa 14-15), jak w oryginalnym ChaCha. */
+    ChaCha20Drbg::ChaCha20Drbg(const std::array<std::uint8_t, 32>& key, std::uint64_t counter, std::uint64_t nonce) {
+        state_[0] = 0x61707865; state_[1] = 0x3320646e; state_[2] = 0x79622d32; state_[3] = 0x6b206574;
+        for (size_t i = 0; i < 8; ++i) state_[4 + i] = load32_le(key.data() + 4 * i);
+        state_[12] = static_cast<std::uint32_t>(counter);
+        state_[13] = static_cast<std::uint32_t>(counter >> 32);
+        state_[14] = static_cast<std::uint32_t>(nonce);
+        state_[15] = static_cast<std::uint32_t>(nonce >> 32);
+    }
+
+    ChaCha20Drbg::ChaCha20Drbg() {
+        std::array<std::uint8_t, 40> seed;
+        os_entropy(seed.data(), seed.size());
+
+        std::array<std::uint8_t, 32> key;
+        std::memcpy(key.data(), seed.data(), key.size());
+        std::uint64_t nonce;
+        std::memcpy(&nonce, seed.data() + 32, sizeof(nonce));
+
+        *this = ChaCha20Drbg(key, 0, nonce);
+        std::memset(seed.data(), 0, seed.size());
+        std::memset(key.data(), 0, key.size());
+    }
+
+    ChaCha20Drbg& ChaCha20Drbg::thread_instance() {
+        thread_local ChaCha20Drbg drbg;
+        return drbg;
+    }
+
+    void ChaCha20Drbg::block(std::uint8_t* out) {
+        std::array<std::uint32_t, 16> x = state_;
+        for (int i = 0; i < 10; ++i) {
+            quarter_round(x[0], x[4], x[8],  x[12]);
+            quarter_round(x[1], x[5], x[9],  x[13]);
+            quarter_round(x[2], x[6], x[10], x[14]);
+            quarter_round(x[3], x[7], x[11], x[15]);
+            quarter_round(x[0], x[5], x[10], x[15]);
+            quarter_round(x[1], x[6], x[11], x[12]);
+            quarter_round(x[2], x[7], x[8],  x[13]);
+            quarter_round(x[3], x[4], x[9],  x[14]);
+        }
+        for (size_t i = 0; i < 16; ++i) {
+            std::uint32_t v = x[i] + state_[i];
+            out[4 * i]     = static_cast<std::uint8_t>(v);
+            out[4 * i + 1] = static_cast<std::uint8_t>(v >> 8);
+            out[4 * i + 2] = static_cast<std::uint8_t>(v >> 16);
+            out[4 * i + 3] = static_cast<std::uint8_t>(v >> 24);
+        }
+        if (++state_[12] == 0) ++state_[13];
+    }
+
+    void ChaCha20Drbg::refill() {
+        for (size_t b = 0; b < buffered_blocks; ++b) block(buffer_.data() + b * block_bytes);
+        pos_ = 0;
+    }
+
+    void ChaCha20Drbg::fill(void* out, size_t len) {
+        auto* p = static_cast<std::uint8_t*>(out);
+
+        // Najpierw resztki bufora, potem pełne bloki prosto do wyjścia
+        size_t take = std::min(len, buffer_.size() - pos_);
+        std::memcpy(p, buffer_.data() + pos_, take);
+        pos_ += take; p += take; len -= take;
+
+        while (len >= block_bytes) {
+            block(p);
+            p += block_bytes; len -= block_bytes;
+        }
+        if (len > 0) {
+            refill();
+            std::memcpy(p, buffer_.data(), len);
+            pos_ = len;
+        }
+    }
+
+    ChaCha20Drbg::result_type ChaCha20Drbg::operator()() {
+        result_type v;
+        fill(&v, sizeof(v));
+        return v;
+    }
+}
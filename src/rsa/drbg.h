@@ -0,0 +1,45 @@
+#ifndef DRBG_H
+#define DRBG_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace rsa {
+    /* Deterministyczny generator losowy oparty na ChaCha20 (RFC 8439, 20 rund).
+     * Jeden egzemplarz na watek (thread_instance), seedowany raz z entropii systemu
+     * (getrandom / BCryptGenRandom); dalej juz tylko bloki ChaCha20 - bez wywolan systemowych.
+     * Spelnia UniformRandomBitGenerator, wiec dziala tez z rozkladami z <random>. */
+    class ChaCha20Drbg {
+    public:
+        using result_type = std::uint64_t;
+
+        ChaCha20Drbg(); // klucz i nonce z entropii systemu
+        ChaCha20Drbg(const std::array<std::uint8_t, 32>& key, std::uint64_t counter, std::uint64_t nonce);
+
+        static ChaCha20Drbg& thread_instance();
+
+        void fill(void* out, size_t len);
+        result_type operator()();
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    private:
+        static constexpr size_t block_bytes = 64;
+        static constexpr size_t buffered_blocks = 4;
+
+        void block(std::uint8_t* out); // jeden blok 64 B, zwieksza licznik
+        void refill();
+
+        std::array<std::uint32_t, 16> state_{};
+        std::array<std::uint8_t, block_bytes * buffered_blocks> buffer_{};
+        size_t pos_ = block_bytes * buffered_blocks;
+    };
+
+    // Entropia systemu operacyjnego (rzuca std::runtime_error, gdy niedostepna)
+    void os_entropy(void* out, size_t len);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef EXP_ENGINE_H
+#define EXP_ENGINE_H
+
+#include <gmpxx.h>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    /* Silnik potegowania niezalezny od arytmetyki.
+     * Ctx musi udostepniac (wszystko w dziedzinie Montgomery'ego):
+     *   const T& one() const;
+     *   void mul(T& r, const T& a, const T& b) const;
+     *   void sqr(T& r, const T& a) const;
+     */
+
+    inline constexpr unsigned int max_window_bits = 6;
+
+    // Szerokosc okna dobrana do dlugosci wykladnika (progi jak w OpenSSL BN_window_bits_for_exponent_size)
+    constexpr unsigned int window_bits_for(size_t exp_bits) {
+        return exp_bits > 671 ? 6 :
+               exp_bits > 239 ? 5 :
+               exp_bits > 79  ? 4 :
+               exp_bits > 23  ? 3 : 1;
+    }
+
+    /* Przesuwne okno od lewej do prawej: tablica nieparzystych poteg base^1, base^3, ...
+     * budowana raz na wywolanie, potem jedno mnozenie na okno zamiast na kazdy ustawiony bit.
+     * Bity wykladnika czytane sa przez mpz_tstbit - bez przesuwania ani kopiowania mpz. */
+    template <class Ctx, class T>
+    void window_pow(const Ctx& ctx, T& r, const T& base_m, const big_int& exp) {
+        if (exp <= 0) {
+            r = ctx.one();
+            return;
+        }
+
+        mpz_srcptr e = exp.get_mpz_t();
+        const size_t bits = mpz_sizeinbase(e, 2);
+        const unsigned int w = window_bits_for(bits);
+
+        // table[k] = base^(2k + 1)
+        std::array<T, size_t(1) << (max_window_bits - 1)> table;
+        table[0] = base_m;
+        if (w > 1) {
+            T base_sq;
+            ctx.sqr(base_sq, base_m);
+            for (size_t k = 1; k < (size_t(1) << (w - 1)); ++k) ctx.mul(table[k], table[k - 1], base_sq);
+        }
+
+        r = ctx.one(); // dopiero po zbudowaniu tablicy - r moze byc aliasem base_m
+        bool first = true;
+        size_t i = bits;
+        while (i-- > 0) {
+            if (!mpz_tstbit(e, i)) {
+                if (!first) ctx.sqr(r, r);
+                continue;
+            }
+
+            // Najdluzsze okno [j, i] o szerokosci <= w konczace sie jedynka
+            size_t j = (i + 1 >= w) ? i + 1 - w : 0;
+            while (!mpz_tstbit(e, j)) ++j;
+
+            size_t val = 0;
+            for (size_t b = i + 1; b-- > j; ) val = (val << 1) | mpz_tstbit(e, b);
+
+            if (first) {
+                r = table[val >> 1];
+                first = false;
+            } else {
+                for (size_t b = j; b <= i; ++b) ctx.sqr(r, r);
+                ctx.mul(r, r, table[val >> 1]);
+            }
+            i = j;
+        }
+    }
+
+    /* Lancuch dodawania dla stalego wykladnika E, rozwijany w czasie kompilacji:
+     * po jednym kwadracie na kazdy bit ponizej najstarszego i mnozenie tylko tam, gdzie bit = 1.
+     * Dla E = 65537 = 2^16 + 1 daje dokladnie 16 kwadratow i 1 mnozenie, bez skanowania wykladnika.
+     * r nie moze byc aliasem base_m. */
+    template <unsigned long E, class Ctx, class T, size_t... I>
+    void chain_steps(const Ctx& ctx, T& r, const T& base_m, std::index_sequence<I...>) {
+        constexpr size_t top = std::bit_width(E) - 1;
+        ([&] {
+            ctx.sqr(r, r);
+            if constexpr (((E >> (top - 1 - I)) & 1) != 0) ctx.mul(r, r, base_m);
+        }(), ...);
+    }
+
+    template <unsigned long E, class Ctx, class T>
+    void chain_pow(const Ctx& ctx, T& r, const T& base_m) {
+        static_assert(E > 0, "chain_pow: exponent must be positive");
+        r = base_m;
+        chain_steps<E>(ctx, r, base_m, std::make_index_sequence<std::bit_width(E) - 1>{});
+    }
+
+    // Typowe wykladniki publiczne; zwraca false, gdy exp nie jest jednym z nich
+    template <class Ctx, class T>
+    bool fixed_exponent_pow(const Ctx& ctx, T& r, const T& base_m, const big_int& exp) {
+        if (!exp.fits_ulong_p()) return false;
+        switch (exp.get_ui()) {
+            case 3:     chain_pow<3>(ctx, r, base_m);     return true;
+            case 17:    chain_pow<17>(ctx, r, base_m);    return true;
+            case 65537: chain_pow<65537>(ctx, r, base_m); return true;
+            default:    return false;
+        }
+    }
+}
+
+#endif
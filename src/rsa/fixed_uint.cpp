@@ -0,0 +1,10 @@
+#include "fixed_uint.h"
+
+namespace rsa {
+    template class FixedMontgomery<512>;
+    template class FixedMontgomery<1024>;
+    template class FixedMontgomery<1536>;
+    template class FixedMontgomery<2048>;
+    template class FixedMontgomery<3072>;
+    template class FixedMontgomery<4096>;
+}
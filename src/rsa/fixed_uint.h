@@ -0,0 +1,215 @@
+#ifndef FIXED_UINT_H
+#define FIXED_UINT_H
+
+#include <gmpxx.h>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+#include "exp_engine.h"
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    using limb_t = mp_limb_t;
+
+    static_assert(GMP_NUMB_BITS == 64 && GMP_NAIL_BITS == 0, "FixedUInt assumes 64-bit GMP limbs");
+
+    /* Operacje na surowych tablicach limbow (little-endian) o dlugosci znanej w czasie kompilacji.
+     * Bufory zawsze na stosie; rachunek na niskopoziomowych funkcjach mpn z GMP
+     * (te same procedury asemblerowe co w mpz, ale bez alokacji i bez normalizacji rozmiaru). */
+    namespace limbs {
+        template <size_t N>
+        inline limb_t add(limb_t* r, const limb_t* a, const limb_t* b) { return mpn_add_n(r, a, b, N); }
+
+        template <size_t N>
+        inline limb_t sub(limb_t* r, const limb_t* a, const limb_t* b) { return mpn_sub_n(r, a, b, N); }
+
+        template <size_t N>
+        inline int cmp(const limb_t* a, const limb_t* b) { return mpn_cmp(a, b, N); }
+
+        // r[0 .. 2N) = a * b (r nie moze nachodzic na a ani b)
+        template <size_t N>
+        inline void mul(limb_t* r, const limb_t* a, const limb_t* b) { mpn_mul_n(r, a, b, N); }
+
+        // r[0 .. 2N) = a^2
+        template <size_t N>
+        inline void sqr(limb_t* r, const limb_t* a) { mpn_sqr(r, a, N); }
+
+        /* REDC: r = t * 2^(-64N) mod n, dla t < n * 2^(64N). t (2N limbow) jest niszczone.
+         * n0inv = -n^-1 mod 2^64 */
+        template <size_t N>
+        inline void redc(limb_t* r, limb_t* t, const limb_t* n, limb_t n0inv) {
+            limb_t top = 0;
+            for (size_t i = 0; i < N; ++i) {
+                limb_t m = t[i] * n0inv;
+                limb_t carry = mpn_addmul_1(t + i, n, N, m);
+                top += mpn_add_1(t + i + N, t + i + N, N - i, carry);
+            }
+
+            // Wynik < 2n lezy w t[N .. 2N) (+ ewentualny bit przeniesienia)
+            if (top || mpn_cmp(t + N, n, N) >= 0) mpn_sub_n(r, t + N, n, N);
+            else for (size_t i = 0; i < N; ++i) r[i] = t[i + N];
+        }
+
+        // Wczytanie mpz (>= 0) do tablicy N limbow; false, gdy wartosc sie nie miesci
+        template <size_t N>
+        inline bool from_mpz(limb_t* r, const big_int& v) {
+            mpz_srcptr z = v.get_mpz_t();
+            const size_t used = mpz_size(z);
+            if (mpz_sgn(z) < 0 || used > N) return false;
+            const mp_limb_t* src = mpz_limbs_read(z);
+            for (size_t i = 0; i < used; ++i) r[i] = src[i];
+            for (size_t i = used; i < N; ++i) r[i] = 0;
+            return true;
+        }
+
+        template <size_t N>
+        inline big_int to_mpz(const limb_t* a) {
+            big_int r;
+            mp_limb_t* dst = mpz_limbs_write(r.get_mpz_t(), N);
+            for (size_t i = 0; i < N; ++i) dst[i] = a[i];
+            mpz_limbs_finish(r.get_mpz_t(), N);
+            return r;
+        }
+    }
+
+    /* Liczba bez znaku o stalej szerokosci Bits, trzymana w calosci na stosie.
+     * Konwersje z/do mpz tylko na brzegach operacji blokowych. */
+    template <unsigned int Bits>
+    struct FixedUInt {
+        static_assert(Bits % 64 == 0, "FixedUInt: Bits must be a multiple of 64");
+        static constexpr size_t limbs = Bits / 64;
+
+        std::array<limb_t, limbs> w{};
+
+        static FixedUInt from_mpz(const big_int& v) {
+            FixedUInt r;
+            if (!limbs::from_mpz<limbs>(r.w.data(), v)) {
+                throw std::runtime_error("FixedUInt: value does not fit in fixed width.");
+            }
+            return r;
+        }
+
+        big_int to_mpz() const { return limbs::to_mpz<limbs>(w.data()); }
+
+        friend bool operator==(const FixedUInt&, const FixedUInt&) = default;
+    };
+
+    /* Kontekst Montgomery'ego dla modulu mieszczacego sie w Bits bitach, R = 2^Bits.
+     * Ten sam interfejs co MontgomeryContext (one/mul/sqr/pow_mont), wiec dziala
+     * z window_pow i chain_pow z exp_engine.h. */
+    template <unsigned int Bits>
+    class FixedMontgomery {
+    public:
+        using value_type = FixedUInt<Bits>;
+        static constexpr size_t N = value_type::limbs;
+
+        explicit FixedMontgomery(const big_int& n) {
+            if (n <= 1 || mpz_even_p(n.get_mpz_t()) || mpz_sizeinbase(n.get_mpz_t(), 2) > Bits) {
+                throw std::runtime_error("FixedMontgomery: modulus must be odd, > 1 and fit in fixed width.");
+            }
+            n_ = value_type::from_mpz(n);
+
+            limb_t n0 = n_.w[0];
+            limb_t inv = n0;
+            for (int i = 0; i < 6; ++i) inv *= 2 - n0 * inv;
+            n0inv_ = -inv;
+
+            // Stale liczone raz przez GMP (brzeg): R mod n, R^2 mod n, R^3 mod n
+            big_int r;
+            mpz_setbit(r.get_mpz_t(), Bits);
+            one_ = value_type::from_mpz(r % n);
+            r = (r * r) % n;
+            r2_ = value_type::from_mpz(r);
+            r3_ = value_type::from_mpz((r * one_.to_mpz()) % n);
+            limbs::sub<N>(minus_one_.w.data(), n_.w.data(), one_.w.data());
+        }
+
+        const value_type& modulus_limbs() const { return n_; }
+        const value_type& one() const { return one_; }
+        const value_type& minus_one() const { return minus_one_; }
+
+        void mul(value_type& r, const value_type& a, const value_type& b) const {
+            std::array<limb_t, 2 * N> t;
+            limbs::mul<N>(t.data(), a.w.data(), b.w.data());
+            limbs::redc<N>(r.w.data(), t.data(), n_.w.data(), n0inv_);
+        }
+
+        void sqr(value_type& r, const value_type& a) const {
+            std::array<limb_t, 2 * N> t;
+            limbs::sqr<N>(t.data(), a.w.data());
+            limbs::redc<N>(r.w.data(), t.data(), n_.w.data(), n0inv_);
+        }
+
+        // r = a - b mod n (a, b < n)
+        void sub_mod(value_type& r, const value_type& a, const value_type& b) const {
+            if (limbs::sub<N>(r.w.data(), a.w.data(), b.w.data())) {
+                limbs::add<N>(r.w.data(), r.w.data(), n_.w.data());
+            }
+        }
+
+        // a (dowolne < R) -> a * R mod n
+        value_type to_mont(const value_type& a) const {
+            value_type r;
+            mul(r, a, r2_);
+            return r;
+        }
+
+        /* a (0 <= a < n * R, np. szyfrogram modulo p*q przy CRT) -> a * R mod n.
+         * REDC sprowadza a do a * R^-1, mnozenie przez R^3 daje a * R - bez dzielenia. */
+        value_type to_mont(const big_int& a) const {
+            std::array<limb_t, 2 * N> t;
+            value_type r;
+            if (limbs::from_mpz<2 * N>(t.data(), a)) {
+                limbs::redc<N>(r.w.data(), t.data(), n_.w.data(), n0inv_);
+                mul(r, r, r3_);
+            } else {
+                big_int reduced;
+                mpz_mod(reduced.get_mpz_t(), a.get_mpz_t(), n_.to_mpz().get_mpz_t());
+                r = to_mont(value_type::from_mpz(reduced));
+            }
+            return r;
+        }
+
+        // a * R^-1 mod n, wynik w pelni zredukowany
+        value_type reduce(const value_type& a) const {
+            std::array<limb_t, 2 * N> t{};
+            for (size_t i = 0; i < N; ++i) t[i] = a.w[i];
+            value_type r;
+            limbs::redc<N>(r.w.data(), t.data(), n_.w.data(), n0inv_);
+            return r;
+        }
+
+        big_int from_mont(const value_type& a) const { return reduce(a).to_mpz(); }
+
+        void pow_mont(value_type& r, const value_type& base_m, const big_int& exp) const {
+            if (&r != &base_m && fixed_exponent_pow(*this, r, base_m, exp)) return;
+            window_pow(*this, r, base_m, exp);
+        }
+
+        big_int pow(const big_int& base, const big_int& exp) const {
+            value_type r;
+            pow_mont(r, to_mont(base), exp);
+            return from_mont(r);
+        }
+
+    private:
+        value_type n_;
+        value_type one_;
+        value_type minus_one_;
+        value_type r2_;
+        value_type r3_;
+        limb_t n0inv_ = 0;
+    };
+
+    // Standardowe szerokosci (polowki CRT i pelne moduly 1024-4096) - instancje w fixed_uint.cpp
+    extern template class FixedMontgomery<512>;
+    extern template class FixedMontgomery<1024>;
+    extern template class FixedMontgomery<1536>;
+    extern template class FixedMontgomery<2048>;
+    extern template class FixedMontgomery<3072>;
+    extern template class FixedMontgomery<4096>;
+}
+
+#endif
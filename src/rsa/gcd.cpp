@@ -0,0 +1,184 @@
+#include "gcd.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace rsa {
+    // Wiodące słowa bez dwóch bitów: sumy x + A w pętli Lehmera nie przepełniają `long`
+    static constexpr size_t word_bits = std::numeric_limits<unsigned long>::digits - 2;
+
+    // r = s * x + t * y (r różne od x i y)
+    static void lincomb(mpz_ptr r, long s, mpz_srcptr x, long t, mpz_srcptr y) {
+        mpz_mul_si(r, x, s);
+        if (t >= 0) mpz_addmul_ui(r, y, static_cast<unsigned long>(t));
+        else mpz_submul_ui(r, y, -static_cast<unsigned long>(t));
+    }
+
+    GcdEngine& GcdEngine::local() {
+        thread_local GcdEngine engine;
+        return engine;
+    }
+
+    void GcdEngine::reduce(bool with_cofactor) {
+        mpz_ptr a = a_.get_mpz_t(), b = b_.get_mpz_t();
+        mpz_ptr x0 = x0_.get_mpz_t(), x1 = x1_.get_mpz_t();
+        mpz_ptr q = q_.get_mpz_t(), t = t_.get_mpz_t(), u = u_.get_mpz_t();
+
+        // Zwykły krok Euklidesa: (a, b) = (b, a mod b), (x0, x1) = (x1, x0 - q * x1)
+        auto euclid_step = [&] {
+            mpz_tdiv_qr(q, t, a, b);
+            mpz_swap(a, b);
+            mpz_swap(b, t);
+            if (with_cofactor) {
+                mpz_set(t, x0);
+                mpz_submul(t, q, x1);
+                mpz_swap(x0, x1);
+                mpz_swap(x1, t);
+            }
+        };
+
+        while (mpz_sgn(b) != 0) {
+            const size_t na = mpz_sizeinbase(a, 2), nb = mpz_sizeinbase(b, 2);
+            if (na <= word_bits || nb > na || na - nb > word_bits / 2) {
+                euclid_step();
+                continue;
+            }
+
+            // Wiodące bity a i b z tym samym przesunięciem
+            const size_t shift = na - word_bits;
+            mpz_tdiv_q_2exp(t, a, shift);
+            long ah = mpz_get_si(t);
+            mpz_tdiv_q_2exp(t, b, shift);
+            long bh = mpz_get_si(t);
+
+            /* Kroki Euklidesa na słowach (Knuth, alg. L): iloraz jest pewny, gdy jest taki sam
+             * dla obu skrajnych przybliżeń (ah + A) / (bh + C) i (ah + B) / (bh + D) */
+            long A = 1, B = 0, C = 0, D = 1;
+            while (bh + C > 0 && bh + D > 0) {
+                const long qh = (ah + A) / (bh + C);
+                if (qh != (ah + B) / (bh + D)) break;
+                long s = A - qh * C; A = C; C = s;
+                s = B - qh * D; B = D; D = s;
+                s = ah - qh * bh; ah = bh; bh = s;
+            }
+
+            if (B == 0) {
+                euclid_step();
+                continue;
+            }
+
+            // (a, b) = (A a + B b, C a + D b), to samo dla kofaktorów
+            lincomb(t, A, a, B, b);
+            lincomb(u, C, a, D, b);
+            mpz_swap(a, t);
+            mpz_swap(b, u);
+            if (with_cofactor) {
+                lincomb(t, A, x0, B, x1);
+                lincomb(u, C, x0, D, x1);
+                mpz_swap(x0, t);
+                mpz_swap(x1, u);
+            }
+        }
+    }
+
+    void GcdEngine::gcd(big_int& g, const big_int& a, const big_int& b) {
+        mpz_abs(a_.get_mpz_t(), a.get_mpz_t());
+        mpz_abs(b_.get_mpz_t(), b.get_mpz_t());
+        reduce(false);
+        mpz_set(g.get_mpz_t(), a_.get_mpz_t());
+    }
+
+    void GcdEngine::gcdext(big_int& g, big_int& x, big_int& y, const big_int& a, const big_int& b) {
+        const int sa = mpz_sgn(a.get_mpz_t()), sb = mpz_sgn(b.get_mpz_t());
+        mpz_abs(abs_a_.get_mpz_t(), a.get_mpz_t());
+        mpz_abs(abs_b_.get_mpz_t(), b.get_mpz_t());
+        a_ = abs_a_;
+        b_ = abs_b_;
+        x0_ = 1;
+        x1_ = 0;
+        reduce(true);
+
+        // y = (g - |a| x) / |b|, dzielenie dokładne
+        if (sb != 0) {
+            mpz_set(t_.get_mpz_t(), a_.get_mpz_t());
+            mpz_submul(t_.get_mpz_t(), abs_a_.get_mpz_t(), x0_.get_mpz_t());
+            mpz_divexact(t_.get_mpz_t(), t_.get_mpz_t(), abs_b_.get_mpz_t());
+        } else {
+            t_ = 0;
+        }
+        if (sa < 0) mpz_neg(x0_.get_mpz_t(), x0_.get_mpz_t());
+        if (sb < 0) mpz_neg(t_.get_mpz_t(), t_.get_mpz_t());
+
+        mpz_set(g.get_mpz_t(), a_.get_mpz_t());
+        mpz_set(x.get_mpz_t(), x0_.get_mpz_t());
+        mpz_set(y.get_mpz_t(), t_.get_mpz_t());
+    }
+
+    bool GcdEngine::invert(big_int& r, const big_int& a, const big_int& m) {
+        if (mpz_sgn(m.get_mpz_t()) <= 0) return false;
+        mpz_fdiv_r(a_.get_mpz_t(), a.get_mpz_t(), m.get_mpz_t());
+        mpz_set(b_.get_mpz_t(), m.get_mpz_t());
+        x0_ = 1;
+        x1_ = 0;
+        reduce(true);
+        if (a_ != 1) return false;
+        mpz_fdiv_r(r.get_mpz_t(), x0_.get_mpz_t(), m.get_mpz_t());
+        return true;
+    }
+
+    bool GcdEngine::batch_invert(std::span<big_int> out, std::span<const big_int> values, const big_int& m) {
+        const size_t n = values.size();
+        if (n == 0) return true;
+
+        // out[i] = v0 * v1 * ... * vi mod m
+        mpz_mod(out[0].get_mpz_t(), values[0].get_mpz_t(), m.get_mpz_t());
+        for (size_t i = 1; i < n; ++i) {
+            mpz_mul(u_.get_mpz_t(), out[i - 1].get_mpz_t(), values[i].get_mpz_t());
+            mpz_mod(out[i].get_mpz_t(), u_.get_mpz_t(), m.get_mpz_t());
+        }
+
+        // inv = (v0 ... vi)^-1; vi^-1 = inv * (v0 ... vi-1), potem inv *= vi
+        big_int inv;
+        if (!invert(inv, out[n - 1], m)) return false;
+        for (size_t i = n - 1; i > 0; --i) {
+            mpz_mul(u_.get_mpz_t(), inv.get_mpz_t(), out[i - 1].get_mpz_t());
+            mpz_mod(out[i].get_mpz_t(), u_.get_mpz_t(), m.get_mpz_t());
+            mpz_mul(u_.get_mpz_t(), inv.get_mpz_t(), values[i].get_mpz_t());
+            mpz_mod(inv.get_mpz_t(), u_.get_mpz_t(), m.get_mpz_t());
+        }
+        out[0] = std::move(inv);
+        return true;
+    }
+
+    bool GcdEngine::invert_many(std::span<big_int> out, const big_int& a, std::span<const big_int> moduli) {
+        if (moduli.empty()) return true;
+        for (const big_int& m : moduli) {
+            if (mpz_sgn(m.get_mpz_t()) <= 0) return false;
+        }
+
+        // Drzewo iloczynów: tree[0] = moduły, tree.back()[0] = iloczyn wszystkich
+        std::vector<std::vector<big_int>> tree(1, std::vector<big_int>(moduli.begin(), moduli.end()));
+        while (tree.back().size() > 1) {
+            const auto& level = tree.back();
+            std::vector<big_int> next((level.size() + 1) / 2);
+            for (size_t i = 0; i + 1 < level.size(); i += 2) next[i / 2] = level[i] * level[i + 1];
+            if (level.size() % 2) next.back() = level.back();
+            tree.push_back(std::move(next));
+        }
+
+        // a * inv = 1 (mod M) daje a * inv = 1 modulo każdego dzielnika M
+        std::vector<big_int> rem(1);
+        if (!invert(rem[0], a, tree.back()[0])) return false;
+        for (size_t l = tree.size() - 1; l-- > 0;) {
+            const auto& level = tree[l];
+            std::vector<big_int> next(level.size());
+            for (size_t i = 0; i < level.size(); ++i) {
+                mpz_mod(next[i].get_mpz_t(), rem[i / 2].get_mpz_t(), level[i].get_mpz_t());
+            }
+            rem = std::move(next);
+        }
+        std::move(rem.begin(), rem.end(), out.begin());
+        return true;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef GCD_H
+#define GCD_H
+
+#include <gmpxx.h>
+#include <span>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    /* NWD metoda Lehmera. Zamiast pelnego dzielenia w kazdym kroku Euklidesa algorytm
+     * prowadzi kilkadziesiat krokow na wiodacych slowach maszynowych obu liczb, zbiera je
+     * w macierz kofaktorow 2x2 i stosuje ja do pelnych liczb naraz (cztery mnozenia przez
+     * slowo). Pelne dzielenie zostaje tylko wtedy, gdy liczby bardzo roznia sie dlugoscia.
+     * Bufory robocze sa polami obiektu, wiec kolejne wywolania nie alokuja pamieci. */
+    class GcdEngine {
+    public:
+        GcdEngine() = default;
+
+        // Instancja watku (bufory wspoldzielone przez kolejne wywolania w tym watku)
+        static GcdEngine& local();
+
+        // g = NWD(|a|, |b|)
+        void gcd(big_int& g, const big_int& a, const big_int& b);
+
+        // g = NWD(|a|, |b|) = a * x + b * y
+        void gcdext(big_int& g, big_int& x, big_int& y, const big_int& a, const big_int& b);
+
+        // r = a^-1 mod m w [0, m); false, gdy NWD(a, m) != 1
+        bool invert(big_int& r, const big_int& a, const big_int& m);
+
+        /* out[i] = values[i]^-1 mod m sztuczka Montgomery'ego: jedna odwrotnosc iloczynu
+         * i 3(n - 1) mnozen modulo m. false (out nieokreslone), gdy ktorakolwiek nie istnieje.
+         * out.size() == values.size(), out nie moze nachodzic na values */
+        bool batch_invert(std::span<big_int> out, std::span<const big_int> values, const big_int& m);
+
+        /* out[i] = a^-1 mod moduli[i]: jedna odwrotnosc modulo iloczyn modulow (drzewo iloczynow),
+         * potem drzewo reszt w dol. Najtaniej dla krotkiego a (np. e przy wielu kluczach). */
+        bool invert_many(std::span<big_int> out, const big_int& a, std::span<const big_int> moduli);
+
+    private:
+        // Petla Lehmera na a_, b_; with_cofactor - prowadzi tez x0_ (kofaktor a przy a_)
+        void reduce(bool with_cofactor);
+
+        big_int a_, b_;   // biezaca para, a_ >= b_ po pierwszym kroku
+        big_int x0_, x1_; // a_ = x0_ * a (mod b), b_ = x1_ * a (mod b)
+        big_int abs_a_, abs_b_; // wejscia gcdext (do wyliczenia y)
+        big_int q_, t_, u_;
+    };
+}
+
+#endif
@@ -0,0 +1,141 @@
+#include "modulus.h"
+#include "spin_worker.h"
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace rsa {
+    // Najwęższa szerokość stała mieszcząca `bits`; 0 -> brak (ogólna ścieżka mpz)
+    static unsigned int fixed_width_for(size_t bits) {
+        for (unsigned int w : { 512u, 1024u, 1536u, 2048u, 3072u, 4096u }) {
+            if (bits <= w) return w;
+        }
+        return 0;
+    }
+
+    static ModulusContext::impl_type make_modulus_impl(const big_int& n) {
+        using impl_type = ModulusContext::impl_type;
+        switch (fixed_width_for(mpz_sizeinbase(n.get_mpz_t(), 2))) {
+            case 512:  return impl_type(std::in_place_type<FixedMontgomery<512>>,  n);
+            case 1024: return impl_type(std::in_place_type<FixedMontgomery<1024>>, n);
+            case 1536: return impl_type(std::in_place_type<FixedMontgomery<1536>>, n);
+            case 2048: return impl_type(std::in_place_type<FixedMontgomery<2048>>, n);
+            case 3072: return impl_type(std::in_place_type<FixedMontgomery<3072>>, n);
+            case 4096: return impl_type(std::in_place_type<FixedMontgomery<4096>>, n);
+            default:   return impl_type(std::in_place_type<MontgomeryContext>, n);
+        }
+    }
+
+    ModulusContext::ModulusContext(const big_int& n) : n_(n), impl_(make_modulus_impl(n)) {}
+
+    big_int ModulusContext::pow(const big_int& base, const big_int& exp) const {
+        return std::visit([&](const auto& ctx) { return ctx.pow(base, exp); }, impl_);
+    }
+
+    big_int crt_combine(const big_int& m1, const big_int& m2,
+                        const big_int& p, const big_int& q, const big_int& qInv) {
+        big_int h = (qInv * (m1 - m2)) % p;
+        if (h < 0) h += p;
+        return m2 + h * q;
+    }
+
+    template <unsigned int Bits>
+    big_int CrtContext::decrypt_fixed(const Fixed<Bits>& f, const big_int& c, SpinWorker* helper) const {
+        using value_type = FixedUInt<Bits>;
+        constexpr size_t N = value_type::limbs;
+
+        // c < p * q < p * R, więc sprowadzenie do dziedziny Montgomery'ego obywa się bez dzielenia
+        value_type x1, x2;
+        auto half_p = [&] { f.P.pow_mont(x1, f.P.to_mont(c), dP_); };
+        auto half_q = [&] { f.Q.pow_mont(x2, f.Q.to_mont(c), dQ_); };
+        if (helper) {
+            helper->run_pair(half_p, half_q);
+        } else {
+            half_p();
+            half_q();
+        }
+
+        // Garner: h = qInv * (m1 - m2) mod p, liczone w dziedzinie Montgomery'ego modulo p
+        value_type m2 = f.Q.reduce(x2);
+        value_type diff, h;
+        f.P.sub_mod(diff, x1, f.P.to_mont(m2));
+        f.P.mul(h, diff, f.qInv); // (m1 - m2) * R * qInv * R^-1 = (m1 - m2) * qInv
+
+        // m = m2 + h * q (< n, mieści się w 2N limbach)
+        std::array<limb_t, 2 * N> m;
+        limbs::mul<N>(m.data(), h.w.data(), f.q.w.data());
+        limb_t carry = limbs::add<N>(m.data(), m.data(), m2.w.data());
+        for (size_t i = N; i < 2 * N && carry; ++i) carry = (++m[i] == 0);
+
+        return limbs::to_mpz<2 * N>(m.data());
+    }
+
+    CrtContext::CrtContext(const big_int& p, const big_int& q,
+                           const big_int& dP, const big_int& dQ, const big_int& qInv,
+                           std::span<const OtherPrimeInfo> others)
+        : dP_(dP), dQ_(dQ),
+          impl_([&]() -> decltype(impl_) {
+              using impl_type = decltype(impl_);
+              auto fixed = [&]<unsigned int Bits>() {
+                  return impl_type(std::in_place_type<Fixed<Bits>>,
+                                   Fixed<Bits>{ FixedMontgomery<Bits>(p), FixedMontgomery<Bits>(q),
+                                                FixedUInt<Bits>::from_mpz(q), FixedUInt<Bits>::from_mpz(qInv) });
+              };
+              size_t bits = std::max(mpz_sizeinbase(p.get_mpz_t(), 2), mpz_sizeinbase(q.get_mpz_t(), 2));
+              switch (fixed_width_for(bits)) {
+                  case 512:  return fixed.template operator()<512>();
+                  case 1024: return fixed.template operator()<1024>();
+                  case 1536: return fixed.template operator()<1536>();
+                  case 2048: return fixed.template operator()<2048>();
+                  case 3072: return fixed.template operator()<3072>();
+                  case 4096: return fixed.template operator()<4096>();
+                  default:
+                      return impl_type(std::in_place_type<Generic>,
+                                       Generic{ MontgomeryContext(p), MontgomeryContext(q), p, q, qInv });
+              }
+          }())
+    {
+        if (others.empty()) return;
+        pq_ = p * q;
+        big_int prefix = pq_;
+        others_.reserve(others.size());
+        for (const OtherPrimeInfo& o : others) {
+            others_.push_back(Other{ ModulusContext(o.r), o.r, o.d, o.t, prefix });
+            prefix *= o.r;
+        }
+    }
+
+    big_int CrtContext::decrypt(const big_int& c, SpinWorker* helper) const {
+        if (others_.empty()) return decrypt_pair(c, helper);
+
+        // c < n jest za duże dla kontekstów czynników - każda potęga liczona z c mod czynnik
+        big_int m = decrypt_pair(c % pq_, helper);
+        big_int m_r, h;
+        for (const Other& o : others_) {
+            m_r = o.R.pow(c % o.r, o.d);
+            h = ((m_r - m) * o.t) % o.r;
+            if (h < 0) h += o.r;
+            m += o.prefix * h;
+        }
+        return m;
+    }
+
+    big_int CrtContext::decrypt_pair(const big_int& c, SpinWorker* helper) const {
+        return std::visit([&]<class F>(const F& f) -> big_int {
+            if constexpr (std::is_same_v<F, Generic>) {
+                big_int m1, m2;
+                auto half_p = [&] { m1 = f.P.pow(c, dP_); };
+                auto half_q = [&] { m2 = f.Q.pow(c, dQ_); };
+                if (helper) {
+                    helper->run_pair(half_p, half_q);
+                } else {
+                    half_p();
+                    half_q();
+                }
+                return crt_combine(m1, m2, f.p, f.q, f.qInv);
+            } else {
+                return decrypt_fixed(f, c, helper);
+            }
+        }, impl_);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef MODULUS_H
+#define MODULUS_H
+
+#include <gmpxx.h>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "fixed_uint.h"
+#include "montgomery.h"
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    class SpinWorker;
+
+    /* Kontekst potegowania dla jednego modulu, wybierany raz przy budowie:
+     * najwezsza pasujaca FixedMontgomery<Bits> (bez alokacji na blok),
+     * a dla nietypowych rozmiarow ogolny MontgomeryContext na mpz. */
+    class ModulusContext {
+    public:
+        using impl_type = std::variant<MontgomeryContext,
+                                       FixedMontgomery<512>,  FixedMontgomery<1024>,
+                                       FixedMontgomery<1536>, FixedMontgomery<2048>,
+                                       FixedMontgomery<3072>, FixedMontgomery<4096>>;
+
+        explicit ModulusContext(const big_int& n);
+
+        const big_int& modulus() const { return n_; }
+        const impl_type& impl() const { return impl_; }
+
+        // base^exp mod n (0 <= base < n * R)
+        big_int pow(const big_int& base, const big_int& exp) const;
+
+    private:
+        big_int n_;
+        impl_type impl_;
+    };
+
+    // Rekombinacja Garnera: m = m2 + q * (qInv * (m1 - m2) mod p)
+    big_int crt_combine(const big_int& m1, const big_int& m2,
+                        const big_int& p, const big_int& q, const big_int& qInv);
+
+    // Kolejny (trzeci, czwarty, ...) czynnik klucza wieloczynnikowego (RFC 8017, OtherPrimeInfo)
+    struct OtherPrimeInfo {
+        big_int r; // czynnik n
+        big_int d; // d mod (r - 1)
+        big_int t; // (p * q * poprzednie r)^-1 mod r - wspolczynnik Garnera
+    };
+
+    /* Deszyfrowanie CRT (Garner) dla ustalonego klucza: konteksty p i q plus wykladniki.
+     * Gdy p i q mieszcza sie w tej samej szerokosci stalej, caly blok (oba potegowania
+     * i rekombinacja) liczony jest na FixedUInt; mpz pojawia sie tylko na wejsciu i wyjsciu.
+     * Klucz wieloczynnikowy: po parze (p, q) kazdy kolejny czynnik r dokladany jest krokiem
+     * Garnera m += (p * q * ...) * ((m_r - m) * t mod r), czyli k potegowan dlugosci n / k. */
+    class CrtContext {
+    public:
+        CrtContext(const big_int& p, const big_int& q,
+                   const big_int& dP, const big_int& dQ, const big_int& qInv,
+                   std::span<const OtherPrimeInfo> others = {});
+
+        /* helper != nullptr - tryb niskiego opoznienia: potegowanie modulo p na watku
+         * pomocniczym, modulo q na wywolujacym (oba naraz), potem rekombinacja */
+        big_int decrypt(const big_int& c, SpinWorker* helper = nullptr) const;
+
+    private:
+        // Dwuczynnikowy CRT dla c < p * q
+        big_int decrypt_pair(const big_int& c, SpinWorker* helper) const;
+
+        struct Other {
+            ModulusContext R;
+            big_int r, d, t;
+            big_int prefix; // iloczyn wszystkich wczesniejszych czynnikow
+        };
+
+        struct Generic {
+            MontgomeryContext P, Q;
+            big_int p, q, qInv;
+        };
+
+        template <unsigned int Bits>
+        struct Fixed {
+            FixedMontgomery<Bits> P, Q;
+            FixedUInt<Bits> q, qInv;
+        };
+
+        template <unsigned int Bits>
+        big_int decrypt_fixed(const Fixed<Bits>& f, const big_int& c, SpinWorker* helper) const;
+
+        big_int dP_, dQ_;
+        big_int pq_;               // p * q (tylko dla kluczy wieloczynnikowych)
+        std::vector<Other> others_;
+        std::variant<Generic, Fixed<512>, Fixed<1024>, Fixed<1536>,
+                     Fixed<2048>, Fixed<3072>, Fixed<4096>> impl_;
+    };
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "montgomery.h"
+#include "exp_engine.h"
+#include <stdexcept>
+
+namespace rsa {
+    // Odwrotność n0 modulo 2^GMP_NUMB_BITS metodą Newtona (n0 nieparzyste)
+    static mp_limb_t limb_inverse(mp_limb_t n0) {
+        mp_limb_t inv = n0; // poprawne na 3 bitach, bo n0 * n0 = 1 (mod 8)
+        for (int i = 0; i < 6; ++i) inv *= 2 - n0 * inv;
+        return inv;
+    }
+
+    MontgomeryContext::MontgomeryContext(const big_int& n) : n_(n) {
+        if (n_ <= 1 || mpz_even_p(n_.get_mpz_t())) {
+            throw std::runtime_error("MontgomeryContext: modulus must be odd and > 1.");
+        }
+        limbs_ = static_cast<mp_size_t>(mpz_size(n_.get_mpz_t()));
+        n0inv_ = -limb_inverse(mpz_getlimbn(n_.get_mpz_t(), 0));
+
+        const mp_bitcnt_t r_bits = static_cast<mp_bitcnt_t>(limbs_) * GMP_NUMB_BITS;
+        mpz_setbit(one_.get_mpz_t(), r_bits);
+        one_ %= n_;
+        mpz_setbit(r2_.get_mpz_t(), 2 * r_bits);
+        r2_ %= n_;
+        minus_one_ = n_ - one_;
+    }
+
+    void MontgomeryContext::redc(big_int& t) const {
+        const mp_size_t k = limbs_;
+        mpz_ptr tz = t.get_mpz_t();
+        const mp_size_t used = static_cast<mp_size_t>(mpz_size(tz));
+
+        // Bufor 2k + 1 limbów; limby powyżej aktualnego rozmiaru t muszą być wyzerowane
+        mp_limb_t* tp = mpz_limbs_modify(tz, 2 * k + 1);
+        for (mp_size_t i = used; i < 2 * k + 1; ++i) tp[i] = 0;
+
+        const mp_limb_t* np = mpz_limbs_read(n_.get_mpz_t());
+        for (mp_size_t i = 0; i < k; ++i) {
+            mp_limb_t m = tp[i] * n0inv_;
+            mp_limb_t carry = mpn_addmul_1(tp + i, np, k, m);
+            mpn_add_1(tp + i + k, tp + i + k, k + 1 - i, carry);
+        }
+
+        // Wynik (< 2n) leży w limbach [k, 2k]; przesuwamy go na początek bufora
+        for (mp_size_t i = 0; i <= k; ++i) tp[i] = tp[i + k];
+        mp_size_t size = k + 1;
+        while (size > 0 && tp[size - 1] == 0) --size;
+        mpz_limbs_finish(tz, size);
+
+        if (t >= n_) t -= n_;
+    }
+
+    big_int MontgomeryContext::to_mont(const big_int& a) const {
+        big_int r;
+        if (a < 0 || a >= n_) {
+            mpz_mod(r.get_mpz_t(), a.get_mpz_t(), n_.get_mpz_t());
+            mul(r, r, r2_);
+        } else {
+            mul(r, a, r2_);
+        }
+        return r;
+    }
+
+    big_int MontgomeryContext::from_mont(const big_int& a) const {
+        big_int r = a;
+        redc(r);
+        return r;
+    }
+
+    void MontgomeryContext::mul(big_int& r, const big_int& a, const big_int& b) const {
+        mpz_mul(r.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+        redc(r);
+    }
+
+    void MontgomeryContext::sqr(big_int& r, const big_int& a) const {
+        mpz_mul(r.get_mpz_t(), a.get_mpz_t(), a.get_mpz_t());
+        redc(r);
+    }
+
+    void MontgomeryContext::pow_mont(big_int& r, const big_int& base_m, const big_int& exp) const {
+        // Wykładniki publiczne 3, 17, 65537 -> łańcuch dodawania rozwinięty w czasie kompilacji
+        if (&r != &base_m && fixed_exponent_pow(*this, r, base_m, exp)) return;
+        window_pow(*this, r, base_m, exp);
+    }
+
+    big_int MontgomeryContext::pow(const big_int& base, const big_int& exp) const {
+        big_int r;
+        pow_mont(r, to_mont(base), exp);
+        redc(r);
+        return r;
+    }
+}
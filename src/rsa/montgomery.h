@@ -0,0 +1,44 @@
+#ifndef MONTGOMERY_H
+#define MONTGOMERY_H
+
+#include <gmpxx.h>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    /* Kontekst arytmetyki Montgomery'ego dla nieparzystego modulu n.
+     * R = 2^(k * GMP_NUMB_BITS), gdzie k to liczba limbow n.
+     * Stale (R mod n, R^2 mod n, n' = -n^-1 mod 2^GMP_NUMB_BITS) liczone sa raz,
+     * a kazde mnozenie konczy sie redukcja REDC zamiast dzielenia przez n. */
+    class MontgomeryContext {
+    public:
+        explicit MontgomeryContext(const big_int& n);
+
+        const big_int& modulus() const { return n_; }
+        const big_int& one() const { return one_; }            // 1 w dziedzinie Montgomery'ego (R mod n)
+        const big_int& minus_one() const { return minus_one_; } // n - 1 w dziedzinie Montgomery'ego
+
+        big_int to_mont(const big_int& a) const;   // a * R mod n
+        big_int from_mont(const big_int& a) const; // a * R^-1 mod n
+
+        // r = a * b * R^-1 mod n (a, b w dziedzinie Montgomery'ego, r moze byc aliasem a lub b)
+        void mul(big_int& r, const big_int& a, const big_int& b) const;
+        void sqr(big_int& r, const big_int& a) const;
+
+        // Potegowanie: pow_mont dziala w calosci w dziedzinie Montgomery'ego
+        void pow_mont(big_int& r, const big_int& base_m, const big_int& exp) const;
+        big_int pow(const big_int& base, const big_int& exp) const;
+
+    private:
+        void redc(big_int& t) const; // t < n * R  ->  t * R^-1 mod n
+
+        big_int n_;
+        mp_size_t limbs_;
+        mp_limb_t n0inv_; // -n^-1 mod 2^GMP_NUMB_BITS
+        big_int r2_;      // R^2 mod n
+        big_int one_;
+        big_int minus_one_;
+    };
+}
+
+#endif
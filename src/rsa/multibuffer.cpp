@@ -0,0 +1,221 @@
+#include "multibuffer.h"
+#include "exp_engine.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RSA_HAVE_IFMA_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace rsa {
+    using u64 = std::uint64_t;
+    using u128 = unsigned __int128;
+
+    static constexpr unsigned int limb_bits = 52;
+    static constexpr u64 limb_mask = (u64(1) << limb_bits) - 1;
+
+    mb::Kernel mb::detect_kernel() {
+#ifdef RSA_HAVE_IFMA_KERNEL
+        static const Kernel kernel = [] {
+            __builtin_cpu_init();
+            return (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma"))
+                ? Kernel::Avx512Ifma : Kernel::Scalar;
+        }();
+        return kernel;
+#else
+        return Kernel::Scalar;
+#endif
+    }
+
+    /* Prawie-Montgomery (AMM) w radiksie 2^52 na wszystkich torach:
+     * r = a * b * R^-1 mod n, przy a, b < 2n i R > 4n wynik tez jest < 2n.
+     * Akumulator ma 2N+1 pozycji; w kroku i aktywne jest okno acc[i .. i+N], więc
+     * dzielenie przez 2^52 to przesunięcie wskaźnika, a nie kopiowanie limbów.
+     * Pozycje dostają co najwyżej 4N składników < 2^52, więc mieszczą się w 64 bitach. */
+    static void amm_scalar(u64* r, const u64* a, const u64* b, const u64* n, u64 n0inv, size_t N) {
+        std::vector<u64> acc(2 * N + 1);
+        for (size_t lane = 0; lane < mb::lanes; ++lane) {
+            std::fill(acc.begin(), acc.end(), 0);
+
+            for (size_t i = 0; i < N; ++i) {
+                u64* w = acc.data() + i;
+                const u64 bi = b[i * mb::lanes + lane];
+                for (size_t j = 0; j < N; ++j) {
+                    u128 p = u128(a[j * mb::lanes + lane]) * bi;
+                    w[j]     += static_cast<u64>(p) & limb_mask;
+                    w[j + 1] += static_cast<u64>(p >> limb_bits);
+                }
+
+                const u64 m = (w[0] * n0inv) & limb_mask;
+                for (size_t j = 0; j < N; ++j) {
+                    u128 p = u128(n[j]) * m;
+                    w[j]     += static_cast<u64>(p) & limb_mask;
+                    w[j + 1] += static_cast<u64>(p >> limb_bits);
+                }
+                w[1] += w[0] >> limb_bits; // młodsze 52 bity w[0] są teraz zerami
+            }
+
+            const u64* res = acc.data() + N;
+            u64 carry = 0;
+            for (size_t j = 0; j < N; ++j) {
+                u64 v = res[j] + carry;
+                r[j * mb::lanes + lane] = v & limb_mask;
+                carry = v >> limb_bits;
+            }
+        }
+    }
+
+#ifdef RSA_HAVE_IFMA_KERNEL
+    __attribute__((target("avx512f,avx512ifma")))
+    static void amm_ifma(u64* r, const u64* a, const u64* b, const u64* n, u64 n0inv, size_t N) {
+        // Bufor akumulatora: dla 4096-bitowego modułu N = 80, czyli ok. 10 KB na stosie
+        constexpr size_t max_limbs = 96;
+        if (N > max_limbs) {
+            amm_scalar(r, a, b, n, n0inv, N);
+            return;
+        }
+
+        __m512i acc[2 * max_limbs + 1];
+        const __m512i zero = _mm512_setzero_si512();
+        for (size_t j = 0; j < 2 * N + 1; ++j) acc[j] = zero;
+
+        const __m512i k0 = _mm512_set1_epi64(static_cast<long long>(n0inv));
+        const __m512i mask = _mm512_set1_epi64(static_cast<long long>(limb_mask));
+
+        for (size_t i = 0; i < N; ++i) {
+            __m512i* w = acc + i;
+            const __m512i bi = _mm512_loadu_si512(b + i * mb::lanes);
+            for (size_t j = 0; j < N; ++j) {
+                const __m512i aj = _mm512_loadu_si512(a + j * mb::lanes);
+                w[j]     = _mm512_madd52lo_epu64(w[j], aj, bi);
+                w[j + 1] = _mm512_madd52hi_epu64(w[j + 1], aj, bi);
+            }
+
+            const __m512i m = _mm512_madd52lo_epu64(zero, w[0], k0);
+            for (size_t j = 0; j < N; ++j) {
+                const __m512i nj = _mm512_set1_epi64(static_cast<long long>(n[j]));
+                w[j]     = _mm512_madd52lo_epu64(w[j], nj, m);
+                w[j + 1] = _mm512_madd52hi_epu64(w[j + 1], nj, m);
+            }
+            w[1] = _mm512_add_epi64(w[1], _mm512_maskz_srli_epi64(0xFF, w[0], limb_bits));
+        }
+
+        __m512i carry = zero;
+        for (size_t j = 0; j < N; ++j) {
+            __m512i v = _mm512_add_epi64(acc[N + j], carry);
+            _mm512_storeu_si512(r + j * mb::lanes, _mm512_and_si512(v, mask));
+            carry = _mm512_maskz_srli_epi64(0xFF, v, limb_bits);
+        }
+    }
+#endif
+
+    // mpz (0 <= v < 2^(52N)) -> limby 52-bitowe toru `lane`
+    static void store_lane(u64* dst, size_t N, size_t lane, const big_int& v) {
+        mpz_srcptr z = v.get_mpz_t();
+        const size_t used = mpz_size(z);
+        const mp_limb_t* src = mpz_limbs_read(z);
+        for (size_t j = 0; j < N; ++j) {
+            const size_t bit = j * limb_bits;
+            const size_t k = bit / 64, off = bit % 64;
+            u64 lo = k < used ? src[k] : 0;
+            u64 hi = k + 1 < used ? src[k + 1] : 0;
+            u64 x = off ? (lo >> off) | (hi << (64 - off)) : lo;
+            dst[j * mb::lanes + lane] = x & limb_mask;
+        }
+    }
+
+    static big_int load_lane(const u64* src, size_t N, size_t lane) {
+        big_int r;
+        const size_t words = (N * limb_bits + 63) / 64;
+        mp_limb_t* dst = mpz_limbs_write(r.get_mpz_t(), static_cast<mp_size_t>(words));
+        for (size_t k = 0; k < words; ++k) dst[k] = 0;
+        for (size_t j = 0; j < N; ++j) {
+            const u64 x = src[j * mb::lanes + lane];
+            const size_t bit = j * limb_bits;
+            const size_t k = bit / 64, off = bit % 64;
+            dst[k] |= x << off;
+            if (off + limb_bits > 64) dst[k + 1] |= x >> (64 - off);
+        }
+        mpz_limbs_finish(r.get_mpz_t(), static_cast<mp_size_t>(words));
+        return r;
+    }
+
+    MultiBufferContext::MultiBufferContext(const big_int& n, mb::Kernel kernel) : n_(n), kernel_(kernel) {
+        if (n_ <= 1 || mpz_even_p(n_.get_mpz_t())) {
+            throw std::runtime_error("MultiBufferContext: modulus must be odd and > 1.");
+        }
+
+        // R = 2^(52N) > 4n, żeby wyniki AMM (< 2n) mogły wracać jako argumenty
+        limbs_ = (mpz_sizeinbase(n_.get_mpz_t(), 2) + 2 + limb_bits - 1) / limb_bits;
+
+        n_limbs_.resize(limbs_);
+        {
+            std::vector<u64> tmp(limbs_ * mb::lanes);
+            store_lane(tmp.data(), limbs_, 0, n_);
+            for (size_t j = 0; j < limbs_; ++j) n_limbs_[j] = tmp[j * mb::lanes];
+        }
+
+        u64 n0 = n_limbs_[0], inv = n0;
+        for (int i = 0; i < 6; ++i) inv *= 2 - n0 * inv;
+        n0inv_ = (0 - inv) & limb_mask;
+
+        big_int r;
+        mpz_setbit(r.get_mpz_t(), limbs_ * limb_bits);
+        big_int one = r % n_;
+        big_int r2 = (one * one) % n_;
+
+        one_.resize(limbs_ * mb::lanes);
+        r2_.resize(limbs_ * mb::lanes);
+        for (size_t lane = 0; lane < mb::lanes; ++lane) {
+            store_lane(one_.data(), limbs_, lane, one);
+            store_lane(r2_.data(), limbs_, lane, r2);
+        }
+
+        amm_ = amm_scalar;
+#ifdef RSA_HAVE_IFMA_KERNEL
+        if (kernel_ == mb::Kernel::Avx512Ifma) amm_ = amm_ifma;
+#else
+        kernel_ = mb::Kernel::Scalar;
+#endif
+    }
+
+    void MultiBufferContext::mul(value_type& r, const value_type& a, const value_type& b) const {
+        r.resize(limbs_ * mb::lanes);
+        amm_(r.data(), a.data(), b.data(), n_limbs_.data(), n0inv_, limbs_);
+    }
+
+    void MultiBufferContext::pow(std::span<const big_int> bases, const big_int& exp, std::span<big_int> out) const {
+        if (bases.size() > mb::lanes || out.size() < bases.size()) {
+            throw std::runtime_error("MultiBufferContext: too many bases for one multi-buffer call.");
+        }
+
+        value_type x(limbs_ * mb::lanes, 0);
+        for (size_t lane = 0; lane < bases.size(); ++lane) {
+            const big_int& b = bases[lane];
+            if (b < 0 || b >= n_) {
+                big_int reduced;
+                mpz_mod(reduced.get_mpz_t(), b.get_mpz_t(), n_.get_mpz_t());
+                store_lane(x.data(), limbs_, lane, reduced);
+            } else {
+                store_lane(x.data(), limbs_, lane, b);
+            }
+        }
+
+        // Do dziedziny Montgomery'ego, wspólny łańcuch potęgowania, z powrotem przez AMM z 1
+        mul(x, x, r2_);
+        value_type acc;
+        if (!fixed_exponent_pow(*this, acc, x, exp)) window_pow(*this, acc, x, exp);
+
+        value_type unit(limbs_ * mb::lanes, 0);
+        for (size_t lane = 0; lane < mb::lanes; ++lane) unit[lane] = 1;
+        mul(acc, acc, unit);
+
+        for (size_t lane = 0; lane < bases.size(); ++lane) {
+            big_int v = load_lane(acc.data(), limbs_, lane);
+            if (v >= n_) v -= n_;
+            out[lane] = std::move(v);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef MULTIBUFFER_H
+#define MULTIBUFFER_H
+
+#include <gmpxx.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    /* Wielobuforowe potegowanie modularne: do `lanes` niezaleznych podstaw, ten sam modul
+     * i ten sam wykladnik, liczone krok w krok. Liczby trzymane sa w limbach 52-bitowych,
+     * przeplecionych po torach (limb i toru l pod indeksem i * lanes + l), tak aby jeden
+     * rejestr 512-bitowy zawieral ten sam limb wszystkich 8 torow.
+     *
+     * Jadro AVX-512 IFMA (vpmadd52luq/vpmadd52huq) wybierane jest w czasie wykonania;
+     * na pozostalych procesorach dziala przenosna wersja skalarna o tym samym ukladzie danych. */
+    namespace mb {
+        inline constexpr size_t lanes = 8;
+
+        enum class Kernel { Scalar, Avx512Ifma };
+
+        Kernel detect_kernel();
+
+        // true, gdy dostepne jest jadro wektorowe (tylko wtedy oplaca sie grupowac bloki)
+        inline bool simd_available() { return detect_kernel() != Kernel::Scalar; }
+
+        // Czy grupowac `blocks` blokow modulo n: jadro SIMD, nieparzysty modul do 4096 bitow, >= 2 bloki
+        inline bool worth_batching(const big_int& n, size_t blocks) {
+            return blocks >= 2 && simd_available() && n > 1 && mpz_odd_p(n.get_mpz_t())
+                && mpz_sizeinbase(n.get_mpz_t(), 2) <= 4096;
+        }
+    }
+
+    class MultiBufferContext {
+    public:
+        using value_type = std::vector<std::uint64_t>; // limbs_ * mb::lanes slow 64-bitowych
+
+        explicit MultiBufferContext(const big_int& n, mb::Kernel kernel = mb::detect_kernel());
+
+        mb::Kernel kernel() const { return kernel_; }
+        const big_int& modulus() const { return n_; }
+
+        // out[i] = bases[i]^exp mod n dla i < bases.size() <= mb::lanes
+        void pow(std::span<const big_int> bases, const big_int& exp, std::span<big_int> out) const;
+
+        // Interfejs dla window_pow / chain_pow (wartosci w dziedzinie Montgomery'ego, < 2n)
+        const value_type& one() const { return one_; }
+        void mul(value_type& r, const value_type& a, const value_type& b) const;
+        void sqr(value_type& r, const value_type& a) const { mul(r, a, a); }
+
+    private:
+        using amm_fn = void (*)(std::uint64_t* r, const std::uint64_t* a, const std::uint64_t* b,
+                                const std::uint64_t* n, std::uint64_t n0inv, size_t limbs);
+
+        big_int n_;
+        size_t limbs_;             // liczba limbow 52-bitowych, R = 2^(52 * limbs_) > 4n
+        std::uint64_t n0inv_;      // -n^-1 mod 2^52
+        std::vector<std::uint64_t> n_limbs_;
+        value_type r2_;            // R^2 mod n na kazdym torze
+        value_type one_;           // R mod n na kazdym torze
+        mb::Kernel kernel_;
+        amm_fn amm_;
+    };
+}
+
+#endif
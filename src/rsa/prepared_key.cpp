@@ -0,0 +1,31 @@
+#include "prepared_key.h"
+#include <algorithm>
+
+namespace rsa {
+    static bool odd_modulus(const big_int& n) { return n > 1 && mpz_odd_p(n.get_mpz_t()); }
+
+    PreparedPubKey::PreparedPubKey(const PubKey& pub, bool with_multibuffer) : key_(pub) {
+        const size_t bits = pub.n > 0 ? mpz_sizeinbase(pub.n.get_mpz_t(), 2) : 0;
+        bytes_ = (bits + 7) / 8;
+        // 256^k <= n  <=>  8k <= bity(n) - 1 (to samo, co dawna pętla limit *= 256)
+        max_block_ = std::max<unsigned int>(1, static_cast<unsigned int>(bits > 0 ? (bits - 1) / 8 : 0));
+
+        if (odd_modulus(pub.n)) ctx_.emplace(pub.n);
+        if (with_multibuffer && mb::worth_batching(pub.n, mb::lanes)) mb_.emplace(pub.n);
+    }
+
+    PreparedPrivKey::PreparedPrivKey(const PrivKey& priv, bool with_multibuffer) : key_(priv) {
+        bytes_ = (mpz_sizeinbase(priv.n.get_mpz_t(), 2) + 7) / 8;
+
+        if (priv.has_crt()) {
+            crt_.emplace(priv.p, priv.q, priv.dP, priv.dQ, priv.qInv, priv.others);
+            if (with_multibuffer && priv.others.empty() && mb::worth_batching(std::max(priv.p, priv.q), mb::lanes)) {
+                mb_p_.emplace(priv.p);
+                mb_q_.emplace(priv.q);
+            }
+        } else if (odd_modulus(priv.n)) {
+            ctx_.emplace(priv.n);
+            if (with_multibuffer && mb::worth_batching(priv.n, mb::lanes)) mb_n_.emplace(priv.n);
+        }
+    }
+}
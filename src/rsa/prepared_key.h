@@ -0,0 +1,70 @@
+#ifndef PREPARED_KEY_H
+#define PREPARED_KEY_H
+
+#include <gmpxx.h>
+#include <cstddef>
+#include <optional>
+
+#include "modulus.h"
+#include "multibuffer.h"
+#include "rsa.h"
+
+namespace rsa {
+    /* Klucz publiczny z wszystkim, co zalezy tylko od modulu, policzonym raz:
+     * dlugosc n w bajtach, najwiekszy blok tekstu jawnego, kontekst Montgomery'ego
+     * (stale R^2 mod n, -n^-1) i kontekst wielobuforowy, gdy jest jadro SIMD.
+     * Tablice okien zaleza od podstawy, wiec powstaja przy kazdym potegowaniu.
+     * Obiekt buduje sie raz na klucz i podaje do wszystkich metod blokowych i tekstowych RSA.
+     * with_multibuffer == false pomija kontekst SIMD (pojedynczy blok go nie uzywa). */
+    class PreparedPubKey {
+    public:
+        explicit PreparedPubKey(const PubKey& pub, bool with_multibuffer = true);
+
+        const PubKey& key() const { return key_; }
+        const big_int& n() const { return key_.n; }
+        const big_int& e() const { return key_.e; }
+
+        size_t byte_length() const { return bytes_; }              // ceil(bity(n) / 8)
+        unsigned int max_block_bytes() const { return max_block_; } // najwieksze k z 256^k <= n (min. 1)
+
+        // nullptr dla n parzystego albo n <= 1 (wtedy zwykle potegowanie)
+        const ModulusContext* context() const { return ctx_ ? &*ctx_ : nullptr; }
+        const MultiBufferContext* multibuffer() const { return mb_ ? &*mb_ : nullptr; }
+
+    private:
+        PubKey key_;
+        size_t bytes_;
+        unsigned int max_block_;
+        std::optional<ModulusContext> ctx_;
+        std::optional<MultiBufferContext> mb_;
+    };
+
+    /* Klucz prywatny z gotowymi kontekstami: CrtContext (p, q i kolejne czynniki) albo
+     * kontekst modulu n dla klucza bez CRT, plus konteksty wielobuforowe dla p i q (albo n),
+     * chyba ze with_multibuffer == false. */
+    class PreparedPrivKey {
+    public:
+        explicit PreparedPrivKey(const PrivKey& priv, bool with_multibuffer = true);
+
+        const PrivKey& key() const { return key_; }
+        const big_int& n() const { return key_.n; }
+        size_t byte_length() const { return bytes_; }
+
+        const CrtContext* crt() const { return crt_ ? &*crt_ : nullptr; }
+        const ModulusContext* context() const { return ctx_ ? &*ctx_ : nullptr; }
+
+        // Grupowanie blokow: dla CRT tylko klucze dwuczynnikowe (p i q), bez CRT modul n
+        const MultiBufferContext* multibuffer_p() const { return mb_p_ ? &*mb_p_ : nullptr; }
+        const MultiBufferContext* multibuffer_q() const { return mb_q_ ? &*mb_q_ : nullptr; }
+        const MultiBufferContext* multibuffer_n() const { return mb_n_ ? &*mb_n_ : nullptr; }
+
+    private:
+        PrivKey key_;
+        size_t bytes_;
+        std::optional<CrtContext> crt_;
+        std::optional<ModulusContext> ctx_;
+        std::optional<MultiBufferContext> mb_p_, mb_q_, mb_n_;
+    };
+}
+
+#endif
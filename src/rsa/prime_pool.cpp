@@ -0,0 +1,309 @@
+#include "prime_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rsa {
+    static constexpr std::uint64_t pool_magic = 0x314c4f4f50415352ull; // "RSAPOOL1"
+    static constexpr std::uint32_t pool_version = 2;                   // 2: blokada pliku zamiast spinlocka w nagłówku
+
+    struct PrimePool::PoolHeader {
+        std::uint64_t magic;    // pool_magic; 0 - plik nie został zainicjalizowany do końca
+        std::uint32_t version;
+        std::uint32_t bits;
+        std::uint64_t capacity; // liczba slotów
+        std::uint64_t count;    // zajęte sloty 0 .. count-1 (tylko pod blokadą)
+        std::uint32_t reserved[2];
+    };
+
+    static_assert(std::atomic_ref<std::uint64_t>::is_always_lock_free,
+                  "PrimePool needs lock-free atomics on the shared mapping");
+
+    /* Operacje na pliku puli wywoływane tylko pod blokadą pliku. Blokada na Windows obejmuje
+     * bajt daleko za końcem pliku, więc nie koliduje z ReadFile / WriteFile nagłówka. */
+#if defined(_WIN32)
+    using NativeFile = HANDLE;
+
+    static OVERLAPPED at_offset(std::uint64_t offset) {
+        OVERLAPPED o{};
+        o.Offset = static_cast<DWORD>(offset);
+        o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        return o;
+    }
+
+    static bool lock_file(NativeFile f) {
+        OVERLAPPED o = at_offset(std::uint64_t(1) << 62);
+        return LockFileEx(f, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &o) != 0;
+    }
+
+    static void unlock_file(NativeFile f) {
+        OVERLAPPED o = at_offset(std::uint64_t(1) << 62);
+        UnlockFileEx(f, 0, 1, 0, &o);
+    }
+
+    static bool file_size(NativeFile f, size_t& size) {
+        LARGE_INTEGER s;
+        if (!GetFileSizeEx(f, &s)) return false;
+        size = static_cast<size_t>(s.QuadPart);
+        return true;
+    }
+
+    static bool set_file_size(NativeFile f, size_t size) {
+        LARGE_INTEGER s;
+        s.QuadPart = static_cast<LONGLONG>(size);
+        return SetFilePointerEx(f, s, nullptr, FILE_BEGIN) && SetEndOfFile(f);
+    }
+
+    static bool read_at(NativeFile f, void* buf, size_t bytes) {
+        OVERLAPPED o = at_offset(0);
+        DWORD done = 0;
+        return ReadFile(f, buf, static_cast<DWORD>(bytes), &done, &o) && done == bytes;
+    }
+
+    static bool write_at(NativeFile f, const void* buf, size_t bytes) {
+        OVERLAPPED o = at_offset(0);
+        DWORD done = 0;
+        return WriteFile(f, buf, static_cast<DWORD>(bytes), &done, &o) && done == bytes;
+    }
+#else
+    using NativeFile = int;
+
+    static bool lock_file(NativeFile f) {
+        while (::flock(f, LOCK_EX) != 0) {
+            if (errno != EINTR) return false;
+        }
+        return true;
+    }
+
+    static void unlock_file(NativeFile f) { ::flock(f, LOCK_UN); }
+
+    static bool file_size(NativeFile f, size_t& size) {
+        struct stat st;
+        if (::fstat(f, &st) != 0) return false;
+        size = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    static bool set_file_size(NativeFile f, size_t size) { return ::ftruncate(f, static_cast<off_t>(size)) == 0; }
+
+    static bool read_at(NativeFile f, void* buf, size_t bytes) {
+        return ::pread(f, buf, bytes, 0) == static_cast<ssize_t>(bytes);
+    }
+
+    static bool write_at(NativeFile f, const void* buf, size_t bytes) {
+        return ::pwrite(f, buf, bytes, 0) == static_cast<ssize_t>(bytes);
+    }
+#endif
+
+    PrimePool::PrimePool(const std::filesystem::path& file, unsigned int bits, size_t capacity)
+        : bits_(bits), slot_words_((bits + 63) / 64) {
+        if (bits < 2 || capacity == 0) {
+            throw std::runtime_error("PrimePool: bits must be >= 2 and capacity > 0.");
+        }
+        const size_t slot_bytes = slot_words_ * sizeof(std::uint64_t);
+
+#if defined(_WIN32)
+        HANDLE f = CreateFileW(file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f == INVALID_HANDLE_VALUE) throw std::runtime_error("PrimePool: unable to open pool file.");
+        file_handle_ = f;
+#else
+        fd_ = ::open(file.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd_ < 0) throw std::runtime_error("PrimePool: unable to open pool file.");
+        const NativeFile f = fd_;
+#endif
+
+        if (!lock_file(f)) {
+            release();
+            throw std::runtime_error("PrimePool: unable to lock pool file.");
+        }
+        auto fail = [&](const char* message) {
+            unlock_file(f);
+            release();
+            throw std::runtime_error(message);
+        };
+
+        /* Nowy plik (albo taki, którego twórca zginął przed zapisem nagłówka) jest zerowany,
+         * wymiarowany na `capacity` slotów i dostaje nagłówek - wszystko pod blokadą pliku,
+         * więc dwa procesy nie ustawią różnych rozmiarów. Istniejący plik nie zmienia rozmiaru. */
+        PoolHeader h{};
+        size_t size = 0;
+        if (!file_size(f, size)) fail("PrimePool: unable to stat pool file.");
+        if (size < sizeof(PoolHeader) || !read_at(f, &h, sizeof(h)) || h.magic == 0) {
+            h = PoolHeader{};
+            h.magic = pool_magic;
+            h.version = pool_version;
+            h.bits = bits;
+            h.capacity = capacity;
+            size = sizeof(PoolHeader) + capacity * slot_bytes;
+            if (!set_file_size(f, 0) || !set_file_size(f, size) || !write_at(f, &h, sizeof(h))) {
+                fail("PrimePool: unable to size pool file.");
+            }
+        }
+
+        if (h.magic != pool_magic || h.version != pool_version) fail("PrimePool: not a prime pool file.");
+        if (h.bits != bits) fail("PrimePool: pool file holds primes of a different size.");
+        if (h.capacity == 0 || h.capacity > (size - sizeof(PoolHeader)) / slot_bytes) {
+            fail("PrimePool: pool file is truncated.");
+        }
+
+        // Mapowanie dokładnie nagłówka i h.capacity slotów
+        mapped_bytes_ = sizeof(PoolHeader) + static_cast<size_t>(h.capacity) * slot_bytes;
+#if defined(_WIN32)
+        HANDLE m = CreateFileMappingW(f, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        if (m) {
+            mapping_handle_ = m;
+            map_ = MapViewOfFile(m, FILE_MAP_ALL_ACCESS, 0, 0, mapped_bytes_);
+        }
+#else
+        void* p = ::mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p != MAP_FAILED) map_ = p;
+#endif
+        if (!map_) fail("PrimePool: unable to map pool file.");
+        unlock_file(f);
+    }
+
+    PrimePool::~PrimePool() {
+        stop_refill();
+        release();
+    }
+
+    void PrimePool::release() {
+#if defined(_WIN32)
+        if (map_) UnmapViewOfFile(map_);
+        if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+        if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+        mapping_handle_ = file_handle_ = nullptr;
+#else
+        if (map_) ::munmap(map_, mapped_bytes_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        map_ = nullptr;
+    }
+
+    std::filesystem::path PrimePool::default_path(const std::filesystem::path& dir, unsigned int bits) {
+        return dir / ("primes_" + std::to_string(bits) + ".pool");
+    }
+
+    PrimePool::PoolHeader* PrimePool::header() const { return static_cast<PoolHeader*>(map_); }
+
+    std::uint64_t* PrimePool::slot(size_t i) const {
+        auto* slots = reinterpret_cast<std::uint64_t*>(static_cast<char*>(map_) + sizeof(PoolHeader));
+        return slots + i * slot_words_;
+    }
+
+    void PrimePool::lock() {
+        lock_mutex_.lock();
+#if defined(_WIN32)
+        const bool locked = lock_file(static_cast<HANDLE>(file_handle_));
+#else
+        const bool locked = lock_file(fd_);
+#endif
+        if (!locked) {
+            lock_mutex_.unlock();
+            throw std::runtime_error("PrimePool: unable to lock pool file.");
+        }
+    }
+
+    void PrimePool::unlock() {
+#if defined(_WIN32)
+        unlock_file(static_cast<HANDLE>(file_handle_));
+#else
+        unlock_file(fd_);
+#endif
+        lock_mutex_.unlock();
+    }
+
+    size_t PrimePool::capacity() const { return static_cast<size_t>(header()->capacity); }
+
+    size_t PrimePool::size() const {
+        return static_cast<size_t>(std::atomic_ref<std::uint64_t>(header()->count).load(std::memory_order_relaxed));
+    }
+
+    std::optional<big_int> PrimePool::pop() {
+        std::atomic_ref<std::uint64_t> count(header()->count);
+        std::optional<big_int> prime;
+
+        lock();
+        if (std::uint64_t c = count.load(std::memory_order_relaxed); c > 0) {
+            std::uint64_t* s = slot(static_cast<size_t>(c - 1));
+            prime.emplace();
+            mpz_import(prime->get_mpz_t(), slot_words_, -1, sizeof(std::uint64_t), 0, 0, s);
+            std::fill(s, s + slot_words_, 0);
+            count.store(c - 1, std::memory_order_relaxed);
+        }
+        unlock();
+
+        if (prime) wake_.notify_all();
+        return prime;
+    }
+
+    bool PrimePool::push(const big_int& prime) {
+        if (prime <= 1 || mpz_sizeinbase(prime.get_mpz_t(), 2) != bits_) {
+            throw std::runtime_error("PrimePool: prime has the wrong bit length for this pool.");
+        }
+        std::atomic_ref<std::uint64_t> count(header()->count);
+        bool stored = false;
+
+        lock();
+        if (std::uint64_t c = count.load(std::memory_order_relaxed); c < header()->capacity) {
+            std::uint64_t* s = slot(static_cast<size_t>(c));
+            std::fill(s, s + slot_words_, 0);
+            mpz_export(s, nullptr, -1, sizeof(std::uint64_t), 0, 0, prime.get_mpz_t());
+            count.store(c + 1, std::memory_order_relaxed);
+            stored = true;
+        }
+        unlock();
+        return stored;
+    }
+
+    void PrimePool::start_refill(PrimeSource source, unsigned int threads, std::chrono::milliseconds poll) {
+        stop_refill();
+        refill_added_ = 0;
+        {
+            std::lock_guard lock(wake_mutex_);
+            refill_error_ = nullptr;
+        }
+        for (unsigned int t = 0; t < std::max(1u, threads); ++t) {
+            fillers_.emplace_back([this, source, poll](std::stop_token stop) {
+                try {
+                    while (!stop.stop_requested()) {
+                        if (size() >= capacity()) {
+                            std::unique_lock lock(wake_mutex_);
+                            wake_.wait_for(lock, stop, poll, [] { return false; });
+                            continue;
+                        }
+                        if (auto prime = source(stop); prime && push(*prime)) ++refill_added_;
+                    }
+                } catch (...) {
+                    std::lock_guard lock(wake_mutex_);
+                    if (!refill_error_) refill_error_ = std::current_exception();
+                }
+            });
+        }
+    }
+
+    std::exception_ptr PrimePool::refill_error() const {
+        std::lock_guard lock(wake_mutex_);
+        return refill_error_;
+    }
+
+    void PrimePool::stop_refill() {
+        for (auto& filler : fillers_) filler.request_stop();
+        wake_.notify_all();
+        fillers_.clear();
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef PRIME_POOL_H
+#define PRIME_POOL_H
+
+#include <gmpxx.h>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    inline constexpr size_t prime_pool_default_capacity = 64;
+
+    /* Zapas przetestowanych liczb pierwszych jednej dlugosci, trzymany w pliku
+     * mapowanym do pamieci (mmap / CreateFileMapping). Ten sam plik moga otworzyc
+     * wszystkie procesy na maszynie - pop/push chroni blokada pliku systemu operacyjnego
+     * (flock / LockFileEx), zwalniana takze wtedy, gdy proces ja trzymajacy zginie.
+     * Pod ta sama blokada plik jest tworzony, wymiarowany i sprawdzany przy otwarciu;
+     * mapowanie ma rozmiar wynikajacy z pojemnosci w naglowku, a nie z biezacej dlugosci pliku.
+     *
+     * Uklad pliku: naglowek (PoolHeader), potem `capacity` slotow po ceil(bits / 64)
+     * slow 64-bitowych (little-endian). Zdjety slot jest zerowany - liczby pierwsze
+     * sa materialem klucza prywatnego, a plik tworzony jest z prawami 0600. */
+    class PrimePool {
+    public:
+        // Generator jednej liczby pierwszej; nullopt, gdy zadano zatrzymania
+        using PrimeSource = std::function<std::optional<big_int>(std::stop_token)>;
+
+        // Otwiera lub tworzy pule; capacity ma znaczenie tylko przy tworzeniu pliku
+        PrimePool(const std::filesystem::path& file, unsigned int bits, size_t capacity);
+        ~PrimePool();
+
+        PrimePool(const PrimePool&) = delete;
+        PrimePool& operator=(const PrimePool&) = delete;
+
+        // <dir>/primes_<bits>.pool
+        static std::filesystem::path default_path(const std::filesystem::path& dir, unsigned int bits);
+
+        unsigned int bits() const { return bits_; }
+        size_t capacity() const;
+        size_t size() const;
+
+        std::optional<big_int> pop();
+        bool push(const big_int& prime); // false, gdy pula jest pelna
+
+        /* Watki w tle dopelniajace zapas do capacity(). Pula moze byc oprozniana przez
+         * inne procesy, wiec pelna pula sprawdzana jest co `poll` zamiast czekac na sygnal. */
+        void start_refill(PrimeSource source, unsigned int threads,
+                          std::chrono::milliseconds poll = std::chrono::milliseconds(50));
+        void stop_refill();
+
+        // Liczby wlozone do puli przez watki ostatniego start_refill (bez zdjetych przez innych)
+        size_t refill_added() const { return refill_added_.load(std::memory_order_relaxed); }
+        // Pierwszy wyjatek ze zrodla - watek, ktory go zlapal, konczy prace
+        std::exception_ptr refill_error() const;
+
+    private:
+        struct PoolHeader;
+
+        PoolHeader* header() const;
+        std::uint64_t* slot(size_t i) const;
+        // Blokada watkow procesu (lock_mutex_) i innych procesow (blokada pliku)
+        void lock();
+        void unlock();
+        void release(); // odmapowanie i zamkniecie pliku (destruktor i bledy w konstruktorze)
+
+        unsigned int bits_;
+        size_t slot_words_;
+        size_t mapped_bytes_ = 0;
+        void* map_ = nullptr;
+#if defined(_WIN32)
+        void* file_handle_ = nullptr;
+        void* mapping_handle_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+
+        std::mutex lock_mutex_; // flock / LockFileEx nie rozrozniaja watkow jednego uchwytu
+        mutable std::mutex wake_mutex_;
+        std::atomic<size_t> refill_added_{ 0 };
+        std::exception_ptr refill_error_; // pod wake_mutex_
+        std::condition_variable_any wake_;
+        std::vector<std::jthread> fillers_;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef PRIME_TABLES_H
+#define PRIME_TABLES_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace rsa::tables {
+    /* Tablice malych liczb pierwszych liczone w czasie kompilacji (sito Eratostenesa w constexpr):
+     * liczby pierwsze < Bound, ich stale Barretta i primorial (iloczyn wszystkich) jako limby.
+     * Rozmiar ustala parametr szablonu; w programie nie ma zadnej inicjalizacji przy starcie. */
+
+    // Sito tylko po liczbach nieparzystych, bit k slowa w odpowiada liczbie 2 * (64 * w + k) + 1
+    template <std::uint32_t Bound>
+    constexpr std::array<std::uint64_t, Bound / 128 + 1> odd_composite_bits() {
+        std::array<std::uint64_t, Bound / 128 + 1> bits{};
+        bits[0] = 1; // 1 nie jest liczba pierwsza
+        for (std::uint64_t i = 3; i * i < Bound; i += 2) {
+            if (bits[i / 128] >> (i / 2 % 64) & 1) continue;
+            for (std::uint64_t j = i * i; j < Bound; j += 2 * i) bits[j / 128] |= std::uint64_t(1) << (j / 2 % 64);
+        }
+        return bits;
+    }
+
+    template <std::uint32_t Bound>
+    constexpr bool odd_is_prime(const std::array<std::uint64_t, Bound / 128 + 1>& bits, std::uint32_t n) {
+        return !(bits[n / 128] >> (n / 2 % 64) & 1);
+    }
+
+    template <std::uint32_t Bound>
+    constexpr size_t prime_count() {
+        const auto bits = odd_composite_bits<Bound>();
+        size_t count = 1; // 2
+        for (std::uint32_t n = 3; n < Bound; n += 2) count += odd_is_prime<Bound>(bits, n);
+        return count;
+    }
+
+    template <std::uint32_t Bound>
+    struct SmallPrimes {
+        static_assert(Bound >= 3 && Bound <= (1u << 16), "SmallPrimes: Bound must be in [3, 2^16]");
+
+        static constexpr size_t count = prime_count<Bound>();
+
+        // 2, 3, 5, ... < Bound
+        static constexpr std::array<std::uint32_t, count> primes = [] {
+            const auto bits = odd_composite_bits<Bound>();
+            std::array<std::uint32_t, count> out{};
+            size_t k = 0;
+            out[k++] = 2;
+            for (std::uint32_t n = 3; n < Bound; n += 2) {
+                if (odd_is_prime<Bound>(bits, n)) out[k++] = n;
+            }
+            return out;
+        }();
+
+        /* m = floor((2^64 - 1) / p): dla x < 2^64 iloraz q = (x * m) >> 64 jest rowny floor(x / p)
+         * albo o 1 mniejszy, wiec x mod p wymaga jednego mnozenia i co najwyzej jednej korekty */
+        static constexpr std::array<std::uint64_t, count> barrett = [] {
+            std::array<std::uint64_t, count> out{};
+            for (size_t i = 0; i < count; ++i) out[i] = std::numeric_limits<std::uint64_t>::max() / primes[i];
+            return out;
+        }();
+
+        // 1 / p w double (stala Barretta dla jader SIMD w residues.cpp)
+        static constexpr std::array<double, count> reciprocal = [] {
+            std::array<double, count> out{};
+            for (size_t i = 0; i < count; ++i) out[i] = 1.0 / primes[i];
+            return out;
+        }();
+
+        // x mod primes[i] przez redukcje Barretta
+        static constexpr std::uint32_t mod(std::uint64_t x, size_t i) {
+            const std::uint64_t q = static_cast<std::uint64_t>((static_cast<unsigned __int128>(x) * barrett[i]) >> 64);
+            std::uint64_t r = x - q * primes[i];
+            if (r >= primes[i]) r -= primes[i];
+            return static_cast<std::uint32_t>(r);
+        }
+    };
+
+    /* Primorial liczb pierwszych < Bound jako limby 64-bitowe little-endian (gorne limby moga byc zerami).
+     * Mnozenie szkolne w constexpr jest kwadratowe - stad limit 2^12 (ok. 5.7 tys. bitow);
+     * wiekszy primorial (PrimorialFilter) budowany jest raz w czasie wykonania z tablicy primes. */
+    template <std::uint32_t Bound>
+    struct Primorial {
+        static_assert(Bound <= (1u << 12), "Primorial: compile-time primorial limited to Bound <= 2^12");
+        using Table = SmallPrimes<Bound>;
+
+        static constexpr size_t limbs = [] {
+            size_t bits = 0;
+            for (std::uint32_t p : Table::primes) bits += static_cast<size_t>(std::bit_width(p));
+            return bits / 64 + 1;
+        }();
+
+        static constexpr std::array<std::uint64_t, limbs> value = [] {
+            std::array<std::uint64_t, limbs> out{};
+            out[0] = 1;
+            size_t used = 1;
+            // Mnoznik skladany z kilku liczb pierwszych, dopoki miesci sie w 64 bitach
+            for (size_t k = 0; k < Table::count;) {
+                std::uint64_t m = 1;
+                while (k < Table::count && m <= std::numeric_limits<std::uint64_t>::max() / Table::primes[k]) {
+                    m *= Table::primes[k++];
+                }
+
+                unsigned __int128 carry = 0;
+                for (size_t i = 0; i < used; ++i) {
+                    unsigned __int128 t = static_cast<unsigned __int128>(out[i]) * m + carry;
+                    out[i] = static_cast<std::uint64_t>(t);
+                    carry = t >> 64;
+                }
+                if (carry) out[used++] = static_cast<std::uint64_t>(carry);
+            }
+            return out;
+        }();
+    };
+}
+
+#endif
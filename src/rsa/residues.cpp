@@ -0,0 +1,171 @@
+#include "residues.h"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RSA_HAVE_SIMD_RESIDUES 1
+#include <immintrin.h>
+#endif
+
+namespace rsa {
+    using u64 = std::uint64_t;
+
+    static constexpr size_t group = 64; // dopełnienie tablic: 8 rejestrów AVX-512 po 8 liczb
+    static constexpr double two32 = 4294967296.0;
+    static constexpr double round_magic = 6755399441055744.0; // 1.5 * 2^52: y + C - C = round(y) dla |y| < 2^51
+
+    residue::Kernel residue::detect_kernel() {
+#ifdef RSA_HAVE_SIMD_RESIDUES
+        static const Kernel kernel = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) return Kernel::Avx512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Kernel::Avx2;
+            return Kernel::Portable;
+        }();
+        return kernel;
+#else
+        return Kernel::Portable;
+#endif
+    }
+
+    ResidueTable::ResidueTable(std::span<const std::uint32_t> primes) : ResidueTable(primes, {}) {}
+
+    ResidueTable::ResidueTable(std::span<const std::uint32_t> primes, std::span<const double> reciprocals)
+        : count_(primes.size()) {
+        if (!reciprocals.empty() && reciprocals.size() != count_) {
+            throw std::runtime_error("ResidueTable: reciprocal table size does not match primes.");
+        }
+        const size_t padded = (count_ + group - 1) / group * group;
+        primes_.assign(padded, 1);
+        primes_f_.assign(padded, 1.0);
+        inverse_f_.assign(padded, 1.0);
+
+        for (size_t i = 0; i < count_; ++i) {
+            const std::uint32_t p = primes[i];
+            if (p < 3 || p > 0xFFFF || p % 2 == 0) {
+                throw std::runtime_error("ResidueTable: primes must be odd and in [3, 2^16).");
+            }
+            primes_[i] = p;
+            primes_f_[i] = p;
+            inverse_f_[i] = reciprocals.empty() ? 1.0 / p : reciprocals[i];
+        }
+    }
+
+#ifdef RSA_HAVE_SIMD_RESIDUES
+    // Cyfry 32-bitowe n od najstarszej, jako double
+    static std::vector<double> digits32(const big_int& n) {
+        mpz_srcptr z = n.get_mpz_t();
+        const size_t limbs = mpz_size(z);
+        std::vector<double> digits;
+        digits.reserve(2 * limbs);
+        for (size_t i = limbs; i-- > 0;) {
+            const u64 limb = mpz_getlimbn(z, static_cast<mp_size_t>(i));
+            digits.push_back(static_cast<double>(limb >> 32));
+            digits.push_back(static_cast<double>(limb & 0xFFFFFFFFu));
+        }
+        return digits;
+    }
+
+    /* Jeden krok Hornera bez korekty: q = round(r * (2^32 / p) + d / p) (zaokrąglenie przez
+     * dodanie i odjęcie 1.5 * 2^52) różni się od x / p o co najwyżej 1, więc r = x - q * p
+     * zostaje w [-p, p] niezależnie od tego, gdzie w tym przedziale było r. |x| < 2^50 jest
+     * dokładne w double, a korekta do [0, p) potrzebna jest tylko raz, na końcu.
+     * 8 niezależnych rejestrów na krok ukrywa opóźnienie łańcucha fma -> sub -> fnmadd. */
+    __attribute__((target("avx2,fma")))
+    static void reduce_avx2(const double* digits, size_t n_digits, const double* primes,
+                            const double* inverse, size_t padded, std::uint32_t* out) {
+        constexpr int regs = 8, width = 4;
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d shift = _mm256_set1_pd(two32);
+        const __m256d round = _mm256_set1_pd(round_magic);
+
+        for (size_t g = 0; g < padded; g += regs * width) {
+            __m256d p[regs], inv[regs], shifted_inv[regs], r[regs];
+            for (int v = 0; v < regs; ++v) {
+                p[v] = _mm256_loadu_pd(primes + g + width * v);
+                inv[v] = _mm256_loadu_pd(inverse + g + width * v);
+                shifted_inv[v] = _mm256_mul_pd(inv[v], shift);
+                r[v] = zero;
+            }
+
+            for (size_t j = 0; j < n_digits; ++j) {
+                const __m256d d = _mm256_set1_pd(digits[j]);
+                for (int v = 0; v < regs; ++v) {
+                    const __m256d x = _mm256_fmadd_pd(r[v], shift, d);
+                    const __m256d q = _mm256_sub_pd(_mm256_fmadd_pd(r[v], shifted_inv[v], _mm256_fmadd_pd(d, inv[v], round)), round);
+                    r[v] = _mm256_fnmadd_pd(q, p[v], x);
+                }
+            }
+
+            for (int v = 0; v < regs; ++v) {
+                __m256d t = r[v];
+                t = _mm256_add_pd(t, _mm256_and_pd(_mm256_cmp_pd(t, zero, _CMP_LT_OQ), p[v]));
+                t = _mm256_sub_pd(t, _mm256_and_pd(_mm256_cmp_pd(t, p[v], _CMP_GE_OQ), p[v]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + g + width * v), _mm256_cvtpd_epi32(t));
+            }
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void reduce_avx512(const double* digits, size_t n_digits, const double* primes,
+                              const double* inverse, size_t padded, std::uint32_t* out) {
+        constexpr int regs = 8, width = 8;
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512d shift = _mm512_set1_pd(two32);
+        const __m512d round = _mm512_set1_pd(round_magic);
+
+        for (size_t g = 0; g < padded; g += regs * width) {
+            __m512d p[regs], inv[regs], shifted_inv[regs], r[regs];
+            for (int v = 0; v < regs; ++v) {
+                p[v] = _mm512_loadu_pd(primes + g + width * v);
+                inv[v] = _mm512_loadu_pd(inverse + g + width * v);
+                shifted_inv[v] = _mm512_mul_pd(inv[v], shift);
+                r[v] = zero;
+            }
+
+            for (size_t j = 0; j < n_digits; ++j) {
+                const __m512d d = _mm512_set1_pd(digits[j]);
+                for (int v = 0; v < regs; ++v) {
+                    const __m512d x = _mm512_fmadd_pd(r[v], shift, d);
+                    const __m512d q = _mm512_sub_pd(_mm512_fmadd_pd(r[v], shifted_inv[v], _mm512_fmadd_pd(d, inv[v], round)), round);
+                    r[v] = _mm512_fnmadd_pd(q, p[v], x);
+                }
+            }
+
+            for (int v = 0; v < regs; ++v) {
+                __m512d t = r[v];
+                t = _mm512_mask_add_pd(t, _mm512_cmp_pd_mask(t, zero, _CMP_LT_OQ), t, p[v]);
+                t = _mm512_mask_sub_pd(t, _mm512_cmp_pd_mask(t, p[v], _CMP_GE_OQ), t, p[v]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + g + width * v), _mm512_maskz_cvtpd_epi32(0xFF, t));
+            }
+        }
+    }
+#endif
+
+    void ResidueTable::reduce(const big_int& n, std::span<std::uint32_t> out, residue::Kernel kernel) const {
+        if (out.size() < count_ || n < 0) {
+            throw std::runtime_error("ResidueTable: output too small or negative input.");
+        }
+#ifdef RSA_HAVE_SIMD_RESIDUES
+        if (kernel != residue::Kernel::Portable) {
+            const std::vector<double> digits_f = digits32(n);
+            std::vector<std::uint32_t> padded_out(primes_.size());
+            if (kernel == residue::Kernel::Avx512) {
+                reduce_avx512(digits_f.data(), digits_f.size(), primes_f_.data(), inverse_f_.data(),
+                              primes_.size(), padded_out.data());
+            } else {
+                reduce_avx2(digits_f.data(), digits_f.size(), primes_f_.data(), inverse_f_.data(),
+                            primes_.size(), padded_out.data());
+            }
+            std::copy_n(padded_out.begin(), count_, out.begin());
+            return;
+        }
+#else
+        (void)kernel;
+#endif
+        // Bez SIMD: mpn_mod_1 z GMP (cyfry 64-bitowe, odwrotność p liczona wewnątrz) jest najszybsze
+        for (size_t i = 0; i < count_; ++i) {
+            out[i] = static_cast<std::uint32_t>(mpz_fdiv_ui(n.get_mpz_t(), primes_[i]));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef RESIDUES_H
+#define RESIDUES_H
+
+#include <gmpxx.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    /* Reszty jednej duzej liczby modulo wielu malych liczb pierwszych naraz (przygotowanie sita).
+     * Liczba rozkladana jest na cyfry 32-bitowe i redukowana schematem Hornera
+     * r = (r * 2^32 + cyfra) mod p, jednoczesnie dla wielu p:
+     *  - AVX-512: 8 liczb pierwszych w rejestrze, 8 rejestrow na krok (64 naraz),
+     *  - AVX2:    4 liczby pierwsze w rejestrze, 8 rejestrow na krok (32 naraz),
+     * w arytmetyce double (wartosci posrednie < 2^50 sa dokladne), z odwrotnoscia 1/p
+     * jako stala Barretta. Bez SIMD reszty liczy mpz_fdiv_ui (mpn_mod_1 z GMP). */
+    namespace residue {
+        enum class Kernel { Portable, Avx2, Avx512 };
+
+        Kernel detect_kernel();
+    }
+
+    class ResidueTable {
+    public:
+        // Male nieparzyste liczby pierwsze 3 <= p < 2^16; stale Barretta liczone raz przy budowie tablicy
+        explicit ResidueTable(std::span<const std::uint32_t> primes);
+        // Jak wyzej, z gotowymi odwrotnosciami 1 / p (np. tables::SmallPrimes::reciprocal)
+        ResidueTable(std::span<const std::uint32_t> primes, std::span<const double> reciprocals);
+
+        std::span<const std::uint32_t> primes() const { return { primes_.data(), count_ }; }
+
+        // out[i] = n mod primes()[i] dla n >= 0; out.size() >= primes().size()
+        void reduce(const big_int& n, std::span<std::uint32_t> out,
+                    residue::Kernel kernel = residue::detect_kernel()) const;
+
+    private:
+        size_t count_;
+        std::vector<std::uint32_t> primes_; // dopelnione do wielokrotnosci 64 jedynkami
+        std::vector<double> primes_f_;
+        std::vector<double> inverse_f_;     // 1 / p
+    };
+}
+
+#endif
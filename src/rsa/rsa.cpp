@@ -1,37 +1,105 @@
 #include "rsa.h"
+#include "gcd.h"
+#include "multibuffer.h"
+#include "prepared_key.h"
+#include "sieve.h"
+#include "spin_worker.h"
+#include "drbg.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <random>
-#include <chrono>
+#include <exception>
 #include <stdexcept>
-#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <thread>
 
 namespace rsa {
-    inline big_int to_big_int(uint64_t val) { return big_int(std::to_string(val)); }
+    RSA::RSA() {}
 
-    RSA::RSA() : mr_rounds_default_(25) {}
+    void RSA::set_prime_count(unsigned int primes) {
+        if (primes < 2 || primes > max_key_primes) {
+            throw std::runtime_error("Number of key primes must be between 2 and 4.");
+        }
+        prime_count_ = primes;
+    }
 
-    // Jeden generator na wątek, seedowany raz
-    static std::mt19937_64& global_rng(unsigned int seed) {
-        thread_local std::mt19937_64 gen(seed);
-        return gen;
+    std::vector<unsigned int> RSA::prime_sizes(unsigned int bits, unsigned int primes) {
+        std::vector<unsigned int> sizes(primes, bits / primes);
+        sizes.back() = bits - (primes - 1) * (bits / primes);
+        return sizes;
     }
 
     void RSA::generate_keys(unsigned int bits, unsigned int mr_rounds) {
         if (bits < 32) {
             throw std::runtime_error("Key size too small; use >= 32 bits for demo.");
         }
-        mr_rounds = (mr_rounds == 0) ? mr_rounds_default_ : mr_rounds;
+        const unsigned int k = prime_count_;
+        if (bits / k < 16) {
+            throw std::runtime_error("Key size too small for the requested number of primes.");
+        }
 
-        // Generowanie dwóch różnych liczb pierwszych p i q o długości ~bits/2
-        unsigned int half = bits / 2;
-        big_int p = generate_prime(half, mr_rounds);
-        big_int q;
-        do {
-            q = generate_prime(bits - half, mr_rounds);
-        } while (q == p);
+        // k różnych liczb pierwszych po ~bits/k bitów (ostatnia dostaje resztę)
+        const std::vector<unsigned int> sizes = prime_sizes(bits, k);
+        auto from_pool = [this](unsigned int b) -> std::optional<big_int> {
+            return (pool_ && pool_->bits() == b) ? pool_->pop() : std::nullopt;
+        };
+
+        // Parami: najpierw zapas z puli (jeśli jest), brakujące liczby szukane na bieżąco
+        std::vector<big_int> primes(k);
+        for (unsigned int i = 0; i < k; i += 2) {
+            if (i + 1 == k) {
+                std::optional<big_int> pooled = from_pool(sizes[i]);
+                primes[i] = pooled ? std::move(*pooled) : generate_prime(sizes[i], mr_rounds);
+                break;
+            }
+            std::optional<big_int> pooled_p = from_pool(sizes[i]);
+            std::optional<big_int> pooled_q = from_pool(sizes[i + 1]);
+            if (pooled_p && pooled_q) {
+                primes[i] = std::move(*pooled_p);
+                primes[i + 1] = std::move(*pooled_q);
+            } else if (pooled_p || pooled_q) {
+                primes[i] = pooled_p ? std::move(*pooled_p) : generate_prime(sizes[i], mr_rounds);
+                primes[i + 1] = pooled_q ? std::move(*pooled_q) : generate_prime(sizes[i + 1], mr_rounds);
+            } else {
+                std::tie(primes[i], primes[i + 1]) = generate_prime_pair(sizes[i], sizes[i + 1], mr_rounds);
+            }
+        }
+        for (unsigned int i = 1; i < k; ++i) {
+            while (std::find(primes.begin(), primes.begin() + i, primes[i]) != primes.begin() + i) {
+                primes[i] = generate_prime(sizes[i], mr_rounds);
+            }
+        }
 
-        big_int n = p * q;
-        big_int phi = (p - 1) * (q - 1);
+        /* Dwa najwyższe bity każdego czynnika dają pełne `bits` dla dwóch czynników, ale przy 3-4
+         * iloczyn może być o bit lub dwa krótszy - wtedy ostatni czynnik losowany jest ponownie
+         * (co ósma próba także pierwszy, gdy iloczyn pozostałych jest za mały) */
+        auto distinct = [&] {
+            for (unsigned int i = 1; i < k; ++i) {
+                if (std::find(primes.begin(), primes.begin() + i, primes[i]) != primes.begin() + i) return false;
+            }
+            return true;
+        };
+        auto product = [&] {
+            big_int r = 1;
+            for (const big_int& f : primes) r *= f;
+            return r;
+        };
+        big_int n = product();
+        for (unsigned int attempt = 1; mpz_sizeinbase(n.get_mpz_t(), 2) != bits || !distinct(); ++attempt) {
+            if (attempt % 8 == 0) primes[0] = generate_prime(sizes[0], mr_rounds);
+            primes.back() = generate_prime(sizes.back(), mr_rounds);
+            n = product();
+        }
+
+        big_int phi = 1;
+        for (const big_int& r : primes) phi *= r - 1;
 
         // Publiczny wykładnik e (standardowo 65537)
         big_int e = 65537;
@@ -47,52 +115,119 @@ namespace rsa {
         pub_.e = e;
         priv_.n = n;
         priv_.d = d;
+
+        // Parametry CRT: wykładniki skrócone modulo (p-1), (q-1) oraz współczynnik Garnera
+        const big_int& p = primes[0];
+        const big_int& q = primes[1];
+        priv_.p = p;
+        priv_.q = q;
+        priv_.dP = d % (p - 1);
+        priv_.dQ = d % (q - 1);
+        priv_.qInv = modinv(q, p);
+
+        // Kolejne czynniki: d mod (r - 1) i odwrotność iloczynu wcześniejszych czynników modulo r
+        priv_.others.clear();
+        big_int prefix = p * q;
+        for (unsigned int i = 2; i < k; ++i) {
+            const big_int& r = primes[i];
+            priv_.others.push_back(OtherPrimeInfo{ r, d % (r - 1), modinv(prefix, r) });
+            prefix *= r;
+        }
     }
 
-    big_int RSA::gcd(big_int a, big_int b) {
-        if (a < 0) a = -a;
-        if (b < 0) b = -b;
+    PrivKey RSA::recover_crt(const PrivKey& priv, const big_int& e) const {
+        const big_int& n = priv.n;
+        big_int k = e * priv.d - 1;
+        if (n < 15 || mpz_even_p(n.get_mpz_t()) || k <= 0 || mpz_odd_p(k.get_mpz_t())) {
+            throw std::runtime_error("Key recovery: (n, e, d) is not a valid RSA key.");
+        }
+
+        // e * d - 1 = 2^s * t, t nieparzyste; g^(e * d - 1) = 1 (mod n) dla każdego g
+        const unsigned long s = mpz_scan1(k.get_mpz_t(), 0);
+        big_int t;
+        mpz_tdiv_q_2exp(t.get_mpz_t(), k.get_mpz_t(), s);
+
+        ModulusContext ctx(n);
+        const big_int minus_one = n - 1;
+        std::optional<big_int> factor;
+        for (int attempt = 0; attempt < 100 && !factor; ++attempt) {
+            big_int g = random_between(2, n - 2);
+            if (big_int f = gcd(g, n); f != 1) {
+                factor = f;
+                break;
+            }
 
-        while (b != 0) {
-            big_int r = a % b;
-            a = b;
-            b = r;
+            // x, x^2, x^4, ...: ostatnia wartość przed 1 różna od ±1 jest nietrywialnym pierwiastkiem z 1
+            big_int x = ctx.pow(g, t);
+            for (unsigned long i = 0; i < s && x != 1 && x != minus_one; ++i) {
+                big_int y = x * x % n;
+                if (y == 1) {
+                    factor = gcd(x - 1, n);
+                    break;
+                }
+                x = std::move(y);
+            }
+        }
+        if (!factor) {
+            throw std::runtime_error("Key recovery: unable to factor n from (e, d).");
+        }
+
+        PrivKey full;
+        full.n = n;
+        full.d = priv.d;
+        full.p = std::max<big_int>(*factor, n / *factor);
+        full.q = n / full.p;
+        if (full.p * full.q != n || full.q == 1) {
+            throw std::runtime_error("Key recovery: unable to factor n from (e, d).");
         }
+        full.dP = full.d % (full.p - 1);
+        full.dQ = full.d % (full.q - 1);
+        full.qInv = modinv(full.q, full.p);
+        return full;
+    }
+
+    // NWD i odwrotności przez GcdEngine wątku (Lehmer, bez alokacji w pętli)
+    big_int RSA::gcd(big_int a, big_int b) {
+        GcdEngine::local().gcd(a, a, b);
         return a;
     }
 
-    void RSA::extended_gcd(const big_int& a_, const big_int& b_, big_int& g, big_int& x, big_int& y) {
-        big_int a = a_, b = b_;
-        big_int x0 = 1, y0 = 0;
-        big_int x1 = 0, y1 = 1;
+    void RSA::extended_gcd(const big_int& a, const big_int& b, big_int& g, big_int& x, big_int& y) {
+        GcdEngine::local().gcdext(g, x, y, a, b);
+    }
 
-        while (b != 0) {
-            big_int q = a / b;
-            big_int r = a % b;
-            big_int nx = x0 - q * x1;
-            big_int ny = y0 - q * y1;
-            a = b; b = r;
-            x0 = x1; x1 = nx;
-            y0 = y1; y1 = ny;
+    big_int RSA::modinv(const big_int& a, const big_int& m) {
+        big_int res;
+        if (!GcdEngine::local().invert(res, a, m)) {
+            throw std::runtime_error("Modular inverse does not exist (gcd != 1).");
         }
-        g = a;
-        x = x0;
-        y = y0;
+        return res;
     }
 
-    big_int RSA::modinv(const big_int& a, const big_int& m) {
-        big_int g, x, y;
-        extended_gcd(a, m, g, x, y);
-        if (g != 1) {
+    std::vector<big_int> RSA::batch_modinv(std::span<const big_int> values, const big_int& m) {
+        std::vector<big_int> res(values.size());
+        if (!GcdEngine::local().batch_invert(res, values, m)) {
+            throw std::runtime_error("Modular inverse does not exist (gcd != 1).");
+        }
+        return res;
+    }
+
+    std::vector<big_int> RSA::modinv_many(const big_int& a, std::span<const big_int> moduli) {
+        std::vector<big_int> res(moduli.size());
+        if (!GcdEngine::local().invert_many(res, a, moduli)) {
             throw std::runtime_error("Modular inverse does not exist (gcd != 1).");
         }
-        big_int res = x % m;
-        if (res < 0) res += m;
         return res;
     }
 
     big_int RSA::modexp(big_int base, big_int exp, const big_int& mod) {
         if (mod == 1) return 0;
+
+        // Nieparzysty modul (zawsze w RSA) -> redukcja Montgomery'ego bez dzielenia
+        if (mod > 1 && mpz_odd_p(mod.get_mpz_t()) && exp > 0) {
+            return MontgomeryContext(mod).pow(base, exp);
+        }
+
         big_int result = 1;
         base %= mod;
         while (exp > 0) {
@@ -103,52 +238,32 @@ namespace rsa {
         return result;
     }
 
-    unsigned int RSA::rng_seed_entropy() const {
-        std::random_device rd;
-        unsigned int seed =
-            static_cast<unsigned int>(
-                std::chrono::high_resolution_clock::now().time_since_epoch().count()
-            ) ^ static_cast<unsigned int>(rd());
-        return seed;
-    }
-
     // Losowa liczba o MAKSYMALNIE k bitach (bez wymuszania najwyższego bitu i bez wymuszania nieparzystości)
     big_int RSA::random_bits(unsigned int k) const {
         if (k == 0) return 0;
 
-        auto& gen = global_rng(rng_seed_entropy());
-        std::uniform_int_distribution<uint64_t> dist(0, std::numeric_limits<uint64_t>::max());
+        // Bajty z DRBG wątku trafiają wprost do limbów mpz (bez konwersji przez tekst)
+        const size_t limbs = (k + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+        big_int r;
+        mp_limb_t* p = mpz_limbs_write(r.get_mpz_t(), static_cast<mp_size_t>(limbs));
+        ChaCha20Drbg::thread_instance().fill(p, limbs * sizeof(mp_limb_t));
 
-        unsigned int full_chunks = k / 64;
-        unsigned int rem_bits = k % 64;
-
-        big_int r = 0;
-        for (unsigned int i = 0; i < full_chunks; ++i) {
-            uint64_t part = dist(gen);
-            r <<= 64;
-            r += to_big_int(part);
-        }
-
-        if (rem_bits) {
-            uint64_t part = dist(gen);
-            if (rem_bits < 64) {
-                uint64_t mask = (uint64_t(1) << rem_bits) - 1;
-                part &= mask;
-            }
-            r <<= rem_bits;
-            r += to_big_int(part);
-        }
+        unsigned int rem_bits = k % GMP_NUMB_BITS;
+        if (rem_bits) p[limbs - 1] &= (mp_limb_t(1) << rem_bits) - 1;
+        mpz_limbs_finish(r.get_mpz_t(), static_cast<mp_size_t>(limbs));
 
         return r;
     }
 
-    // Losowa liczba dokładnie k-bitowa, nieparzysta (dobry kandydat na liczbę pierwszą)
+    /* Losowa liczba dokładnie k-bitowa, nieparzysta (dobry kandydat na liczbę pierwszą).
+     * Dwa najwyższe bity ustawione: iloczyn dwóch takich liczb ma pełne 2k bitów */
     big_int RSA::random_k_bit(unsigned int k) const {
         if (k == 0) return 0;
 
         big_int r = random_bits(k);
-        r |= (big_int(1) << (k - 1)); // wymuś najwyższy bit -> dokładnie k bitów
-        r |= 1;                       // wymuś nieparzystość
+        r |= (big_int(1) << (k - 1));            // wymuś najwyższy bit -> dokładnie k bitów
+        if (k >= 2) r |= (big_int(1) << (k - 2)); // i drugi najwyższy -> r >= 3/4 * 2^k
+        r |= 1;                                   // wymuś nieparzystość
         return r;
     }
 
@@ -176,15 +291,125 @@ namespace rsa {
     }
 
     // Miller-Rabin
-    bool RSA::is_probable_prime(const big_int& n, unsigned int rounds) const {
-        if (n < 2) return false;
+    // Silny test Fermata przy podstawie a (n - 1 = d * 2^s, d nieparzyste)
+    static bool strong_probable_prime(const MontgomeryContext& ctx, const big_int& a,
+                                      const big_int& d, unsigned int s) {
+        // x pozostaje w dziedzinie Montgomery'ego; porównujemy z obrazami 1 i n-1
+        big_int x;
+        ctx.pow_mont(x, ctx.to_mont(a), d);
+        if (x == ctx.one() || x == ctx.minus_one()) return true;
+
+        for (unsigned int r = 1; r < s; ++r) {
+            ctx.sqr(x, x);
+            if (x == ctx.minus_one()) return true;
+        }
+        return false;
+    }
 
-        static const int small_primes[] = {2,3,5,7,11,13,17,19,23,29,31,37,41,43,47};
-        for (int p : small_primes) {
-            if (n == p) return true;
-            if (n % p == 0) return false;
+    /* Silny test Lucasa (Baillie, Wagstaff 1980) z parametrami Selfridge'a, metoda A:
+     * pierwsze D z ciągu 5, -7, 9, -11, ... o symbolu Jacobiego (D/n) = -1, P = 1, Q = (1 - D) / 4.
+     * n + 1 = k * 2^s; n przechodzi, gdy U_k = 0 albo V_(k * 2^r) = 0 dla pewnego 0 <= r < s.
+     * Ciągi liczone drabinką po bitach k, w całości w dziedzinie Montgomery'ego
+     * (dodawanie i połowienie modulo n są liniowe, więc nie wymagają konwersji). */
+    static bool strong_lucas_probable_prime(const MontgomeryContext& ctx) {
+        const big_int& n = ctx.modulus();
+
+        // Dla kwadratu nie istnieje D z (D/n) = -1
+        if (mpz_perfect_square_p(n.get_mpz_t())) return false;
+
+        long D = 5;
+        for (;;) {
+            int j = mpz_si_kronecker(D, n.get_mpz_t());
+            if (j == -1) break;
+            if (j == 0) return false; // |D| < n dzieli n (n jest większe od granicy filtra wstępnego)
+            D = (D > 0) ? -(D + 2) : -D + 2;
         }
 
+        auto add_mod = [&n](big_int& r, const big_int& a, const big_int& b) {
+            r = a + b;
+            if (r >= n) r -= n;
+        };
+        auto sub_mod = [&n](big_int& r, const big_int& a, const big_int& b) {
+            r = a - b;
+            if (r < 0) r += n;
+        };
+        auto half_mod = [&n](big_int& r) {
+            if (mpz_odd_p(r.get_mpz_t())) r += n;
+            r >>= 1;
+        };
+
+        const big_int d_m = ctx.to_mont(big_int(D));
+        const big_int q_m = ctx.to_mont(big_int((1 - D) / 4));
+
+        big_int k = n + 1;
+        unsigned int s = 0;
+        while ((k & 1) == 0) {
+            k >>= 1;
+            ++s;
+        }
+
+        // U_1 = 1, V_1 = P = 1, Q^1
+        big_int u = ctx.one(), v = ctx.one(), qk = q_m, t;
+        for (size_t i = mpz_sizeinbase(k.get_mpz_t(), 2) - 1; i-- > 0;) {
+            // U_2j = U_j V_j, V_2j = V_j^2 - 2 Q^j
+            ctx.mul(u, u, v);
+            ctx.sqr(v, v);
+            sub_mod(v, v, qk);
+            sub_mod(v, v, qk);
+            ctx.sqr(qk, qk);
+
+            if (mpz_tstbit(k.get_mpz_t(), i)) {
+                // U_(j+1) = (U_j + V_j) / 2, V_(j+1) = (D U_j + V_j) / 2
+                ctx.mul(t, d_m, u);
+                add_mod(u, u, v);
+                half_mod(u);
+                add_mod(v, t, v);
+                half_mod(v);
+                ctx.mul(qk, qk, q_m);
+            }
+        }
+
+        if (u == 0 || v == 0) return true;
+        for (unsigned int r = 1; r < s; ++r) {
+            ctx.sqr(v, v);
+            sub_mod(v, v, qk);
+            sub_mod(v, v, qk);
+            if (v == 0) return true;
+            ctx.sqr(qk, qk);
+        }
+        return false;
+    }
+
+    unsigned int RSA::mr_rounds_for_bits(unsigned int bits) {
+        /* Tabela BN_prime_checks_for_size z OpenSSL 1.1: błąd < 2^-80 dla losowych kandydatów
+         * (oszacowania Damgårda-Landrocka-Pomerance'a) */
+        return bits >= 3747 ?  3 :
+               bits >= 1345 ?  4 :
+               bits >=  476 ?  5 :
+               bits >=  400 ?  6 :
+               bits >=  347 ?  7 :
+               bits >=  308 ?  8 :
+               bits >=   55 ? 27 :
+                              34;
+    }
+
+    bool RSA::is_probable_prime(const big_int& n, unsigned int rounds) const {
+        // Jedno NWD z iloczynem liczb pierwszych < granicy zamiast dzielenia próbnego
+        if (int small = prefilter_->classify(n); small >= 0) return small == 1;
+        return miller_rabin(n, rounds);
+    }
+
+    bool RSA::is_bpsw_prime(const big_int& n) const {
+        if (int small = prefilter_->classify(n); small >= 0) return small == 1;
+        return baillie_psw(n);
+    }
+
+    bool RSA::miller_rabin(const big_int& n, unsigned int rounds) const {
+        if (rounds == 0) rounds = mr_rounds_for_bits(static_cast<unsigned int>(mpz_sizeinbase(n.get_mpz_t(), 2)));
+
+        // Od tego miejsca n jest nieparzyste -> jeden kontekst Montgomery'ego na kandydata
+        MontgomeryContext ctx(n);
+
         // Zapis n-1 jako d * 2^s
         big_int d = n - 1;
         unsigned int s = 0;
@@ -193,130 +418,339 @@ namespace rsa {
             ++s;
         }
 
-        auto& gen = global_rng(rng_seed_entropy());
-
-        for (unsigned int i = 0; i < rounds; ++i) {
-            big_int a;
-
+        // Losowa podstawa z [2, n-2]; generator jest per wątek, więc działa też na pomocnikach puli
+        auto random_base = [&]() -> big_int {
             if (n.fits_ulong_p()) {
                 unsigned long n_val = n.get_ui();
-                if (n_val <= 4) return (n_val == 2 || n_val == 3);
-
                 std::uniform_int_distribution<unsigned long> dist_a(2, n_val - 2);
-                a = to_big_int(dist_a(gen));
-            } else {
-                a = random_between(2, n - 2);
+                return big_int(dist_a(ChaCha20Drbg::thread_instance()));
             }
+            return random_between(2, n - 2);
+        };
 
-            big_int x = modexp(a, d, n);
-            if (x == 1 || x == n - 1) continue;
+        // Pierwsza runda zawsze na miejscu: odsiewa niemal wszystkie liczby złożone
+        if (!strong_probable_prime(ctx, random_base(), d, s)) return false;
 
-            bool composite = true;
-            for (unsigned int r = 1; r < s; ++r) {
-                x = (x * x) % n;
-                if (x == n - 1) {
-                    composite = false;
-                    break;
-                }
+        ThreadPool& pool = ThreadPool::shared();
+        if (mpz_sizeinbase(n.get_mpz_t(), 2) < parallel_mr_min_bits || pool.workers() == 0) {
+            for (unsigned int i = 1; i < rounds; ++i) {
+                if (!strong_probable_prime(ctx, random_base(), d, s)) return false;
             }
-            if (composite) return false;
+            return true;
         }
-        return true;
+
+        // Pozostałe rundy są niezależne - każda na innym rdzeniu; po pierwszym świadku reszta jest pomijana
+        std::atomic<bool> composite{ false };
+        pool.run(rounds - 1, [&](size_t) {
+            if (composite.load(std::memory_order_relaxed)) return;
+            if (!strong_probable_prime(ctx, random_base(), d, s)) composite.store(true, std::memory_order_relaxed);
+        });
+        return !composite.load();
+    }
+
+    bool RSA::baillie_psw(const big_int& n) {
+        MontgomeryContext ctx(n);
+
+        big_int d = n - 1;
+        unsigned int s = 0;
+        while ((d & 1) == 0) {
+            d >>= 1;
+            ++s;
+        }
+
+        // Nie jest znany żaden złożony n, który przechodzi oba testy naraz
+        return strong_probable_prime(ctx, 2, d, s) && strong_lucas_probable_prime(ctx);
+    }
+
+    bool RSA::passes_primality_test(const big_int& n, unsigned int mr_rounds) const {
+        // Bardzo małe klucze: kandydat poniżej granicy filtra rozstrzygany odczytem z tablicy
+        if (n < prefilter_->bound()) return prefilter_->classify(n) == 1;
+        return primality_ == PrimalityTest::BailliePSW ? baillie_psw(n) : miller_rabin(n, mr_rounds);
     }
 
     big_int RSA::generate_prime(unsigned int bits, unsigned int mr_rounds) const {
+        return *search_prime(bits, mr_rounds, std::stop_token{});
+    }
+
+    std::optional<big_int> RSA::search_prime(unsigned int bits, unsigned int mr_rounds, std::stop_token stop) const {
         if (bits < 2) throw std::runtime_error("generate_prime: bits must be >= 2");
-        while (true) {
-            big_int cand = random_k_bit(bits);
-            if (is_probable_prime(cand, mr_rounds)) return cand;
+        while (!stop.stop_requested()) {
+            // Jeden losowy start, potem kolejne nieparzyste liczby przez sito reszt
+            CandidateSieve sieve(random_k_bit(bits), bits);
+            big_int cand;
+            while (sieve.next(cand)) {
+                if (stop.stop_requested()) return std::nullopt;
+                if (passes_primality_test(cand, mr_rounds)) return cand;
+            }
         }
+        return std::nullopt;
     }
 
-    big_int RSA::encrypt_block(const big_int& m, const PubKey& pub) const {
-        if (m < 0 || m >= pub.n) {
-            throw std::runtime_error("Plaintext block out of range (<0 or >= n).");
+    void RSA::start_pool_refill(PrimePool& pool, unsigned int threads, unsigned int mr_rounds) const {
+        // Kopia samej konfiguracji testu - bez kluczy i bez puli (wątki nie trzymają jej przy życiu)
+        RSA engine;
+        engine.primality_ = primality_;
+        engine.prefilter_ = prefilter_;
+        pool.start_refill([engine, bits = pool.bits(), mr_rounds](std::stop_token stop) {
+            return engine.search_prime(bits, mr_rounds, stop);
+        }, threads);
+    }
+
+    std::pair<big_int, big_int> RSA::generate_prime_pair(unsigned int bits_p, unsigned int bits_q,
+                                                         unsigned int mr_rounds) const {
+        unsigned int threads = keygen_threads_ ? keygen_threads_ : std::thread::hardware_concurrency();
+        if (threads < 2) {
+            big_int p = generate_prime(bits_p, mr_rounds);
+            return { p, generate_prime(bits_q, mr_rounds) };
         }
-        return modexp(m, pub.e, pub.n);
+
+        /* Dwa wyścigi naraz: wątki parzyste szukają p, nieparzyste q. Każdy wątek zaczyna
+         * od własnego losowego startu (rozłączne strumienie kandydatów); pierwszy znaleziony
+         * wynik zatrzymuje pozostałych uczestników tego samego wyścigu. */
+        struct Race {
+            std::stop_source stop;
+            std::mutex mutex;
+            std::optional<big_int> winner;
+            std::exception_ptr error;
+        };
+        std::array<Race, 2> races;
+        const std::array<unsigned int, 2> bits = { bits_p, bits_q };
+
+        {
+            std::vector<std::jthread> workers;
+            for (unsigned int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, which = t % 2] {
+                    Race& race = races[which];
+                    try {
+                        auto found = search_prime(bits[which], mr_rounds, race.stop.get_token());
+                        std::lock_guard lock(race.mutex);
+                        if (found && !race.winner) {
+                            race.winner = std::move(found);
+                            race.stop.request_stop();
+                        }
+                    } catch (...) {
+                        std::lock_guard lock(race.mutex);
+                        if (!race.error) race.error = std::current_exception();
+                        race.stop.request_stop();
+                    }
+                });
+            }
+        }
+
+        for (Race& race : races) {
+            if (race.error) std::rethrow_exception(race.error);
+        }
+        return { std::move(*races[0].winner), std::move(*races[1].winner) };
+    }
+
+    // Pojedynczy blok: bez kontekstów wielobuforowych (konwersja modułu do radix 2^52 nic tu nie daje)
+    big_int RSA::encrypt_block(const big_int& m, const PubKey& pub) const {
+        return encrypt_block(m, PreparedPubKey(pub, false));
     }
 
     big_int RSA::decrypt_block(const big_int& c, const PrivKey& priv) const {
-        if (c < 0 || c >= priv.n) {
-            throw std::runtime_error("Ciphertext block out of range (<0 or >= n).");
-        }
-        return modexp(c, priv.d, priv.n);
+        return decrypt_block(c, PreparedPrivKey(priv, false));
     }
 
     std::vector<big_int> RSA::encrypt_string(const std::string& message, const PubKey& pub) const {
-        std::vector<big_int> blocks;
         if (pub.n == 0) throw std::runtime_error("Public key not set (n==0).");
+        return encrypt_string(message, PreparedPubKey(pub));
+    }
+
+    std::string RSA::decrypt_string(const std::vector<big_int>& cipher_blocks, const PrivKey& priv) const {
+        return decrypt_string(cipher_blocks, PreparedPrivKey(priv));
+    }
 
-        unsigned int max_bytes = 1;
-        big_int limit = 256; // 256^1
-        while (limit <= pub.n) {
-            ++max_bytes;
-            limit *= 256;
+    big_int RSA::encrypt_block(const big_int& m, const PreparedPubKey& pub) const {
+        if (m < 0 || m >= pub.n()) {
+            throw std::runtime_error("Plaintext block out of range (<0 or >= n).");
         }
-        max_bytes = std::max<unsigned int>(1, max_bytes - 1);
+        // e = 3, 17, 65537 trafia w pow() na gotowy łańcuch dodawania zamiast ogólnego okna
+        if (const ModulusContext* ctx = pub.context()) return ctx->pow(m, pub.e());
+        return modexp(m, pub.e(), pub.n());
+    }
 
-        size_t i = 0;
-        while (i < message.size()) {
-            unsigned int take = std::min<size_t>(max_bytes, message.size() - i);
-            big_int m = 0;
+    // Deszyfrowanie z CRT: potęgowania modulo p i q (i kolejnych czynników), rekombinacja wzorem Garnera
+    big_int RSA::decrypt_block(const big_int& c, const PreparedPrivKey& priv) const {
+        if (c < 0 || c >= priv.n()) {
+            throw std::runtime_error("Ciphertext block out of range (<0 or >= n).");
+        }
+        if (const CrtContext* crt = priv.crt()) {
+            return crt->decrypt(c, latency_mode_ ? &SpinWorker::shared() : nullptr);
+        }
+        if (const ModulusContext* ctx = priv.context()) return ctx->pow(c, priv.key().d);
+        return modexp(c, priv.key().d, priv.n());
+    }
 
-            for (unsigned int j = 0; j < take; ++j) {
-                unsigned char byte = static_cast<unsigned char>(message[i + j]);
-                m <<= 8;
-                m += byte;
-            }
+    // Grupy po mb::lanes bloków na ThreadPool::shared() (sekwencyjnie przy jednej grupie albo bez pomocników)
+    static void for_each_group(size_t blocks, const std::function<void(size_t, size_t)>& fn) {
+        const size_t groups = (blocks + mb::lanes - 1) / mb::lanes;
+        ThreadPool& pool = ThreadPool::shared();
+        auto group = [&](size_t g) {
+            const size_t b = g * mb::lanes;
+            fn(b, std::min(mb::lanes, blocks - b));
+        };
+        if (groups > 1 && pool.workers() > 0) {
+            pool.run(groups, group);
+        } else {
+            for (size_t g = 0; g < groups; ++g) group(g);
+        }
+    }
 
-            if (m >= pub.n) {
-                // zmniejszenie rozmiaru bloku aż m < n
-                bool adjusted = false;
-                for (int dec = static_cast<int>(take) - 1; dec >= 1; --dec) {
-                    big_int mm = 0;
-                    for (int j = 0; j < dec; ++j) {
-                        unsigned char byte = static_cast<unsigned char>(message[i + j]);
-                        mm <<= 8;
-                        mm += byte;
-                    }
-                    if (mm < pub.n) {
-                        take = static_cast<unsigned int>(dec);
-                        m = mm;
-                        adjusted = true;
-                        break;
-                    }
+    /* Blok b ramki Fixed: bajty [b * chunk, (b + 1) * chunk) ciągu wiadomość || zera || długość.
+     * Pełne bloki importowane wprost z wiadomości, tylko końcowe składane w buforze */
+    static void pack_fixed_block(big_int& m, const std::string& message, size_t chunk, size_t total, size_t b) {
+        const size_t offset = b * chunk;
+        if (offset + chunk <= message.size()) {
+            mpz_import(m.get_mpz_t(), chunk, 1, 1, 1, 0, message.data() + offset);
+            return;
+        }
+
+        std::string tail(chunk, '\0');
+        if (offset < message.size()) std::copy(message.begin() + offset, message.end(), tail.begin());
+        const std::uint64_t length = message.size();
+        for (size_t j = std::max(offset, total - frame_trailer_bytes); j < offset + chunk; ++j) {
+            tail[j - offset] = static_cast<char>(length >> (8 * (total - 1 - j)) & 0xff);
+        }
+        mpz_import(m.get_mpz_t(), chunk, 1, 1, 1, 0, tail.data());
+    }
+
+    std::vector<big_int> RSA::encrypt_string(const std::string& message, const PreparedPubKey& pub) const {
+        std::vector<big_int> blocks;
+        if (pub.n() == 0) throw std::runtime_error("Public key not set (n==0).");
+
+        std::vector<big_int> plain;
+        const bool fixed = framing_ == Framing::Fixed;
+        size_t chunk = 0, total = 0;
+        if (fixed) {
+            // k - 1 bajtów daje m < 256^(k-1) <= n dla każdego bloku - bez sprawdzania i cofania
+            if (pub.byte_length() < 2) throw std::runtime_error("Fixed framing requires a modulus of at least 2 bytes.");
+            chunk = pub.byte_length() - 1;
+            total = (message.size() + frame_trailer_bytes + chunk - 1) / chunk * chunk;
+            plain.resize(total / chunk);
+        } else {
+            const unsigned int max_bytes = pub.max_block_bytes();
+            plain.reserve(message.size() / max_bytes + 1);
+            size_t i = 0;
+            while (i < message.size()) {
+                unsigned int take = std::min<size_t>(max_bytes, message.size() - i);
+
+                // Blok jako jedna liczba big-endian prosto z bufora wiadomości
+                big_int& m = plain.emplace_back();
+                mpz_import(m.get_mpz_t(), take, 1, 1, 1, 0, message.data() + i);
+
+                // zmniejszenie rozmiaru bloku aż m < n (krótszy prefiks to m bez ostatniego bajtu)
+                while (m >= pub.n() && take > 1) {
+                    mpz_tdiv_q_2exp(m.get_mpz_t(), m.get_mpz_t(), 8);
+                    --take;
                 }
-                if (!adjusted) throw std::runtime_error("Failed to fit block under modulus n.");
-            }
+                if (m >= pub.n()) throw std::runtime_error("Failed to fit block under modulus n.");
 
-            blocks.push_back(encrypt_block(m, pub));
-            i += take;
+                i += take;
+            }
         }
 
+        // Bloki są niezależne: przy dostępnym SIMD liczymy je grupami po mb::lanes
+        blocks.resize(plain.size());
+        const MultiBufferContext* mbc = plain.size() >= 2 ? pub.multibuffer() : nullptr;
+        for_each_group(plain.size(), [&](size_t b, size_t count) {
+            if (fixed) {
+                for (size_t k = b; k < b + count; ++k) pack_fixed_block(plain[k], message, chunk, total, k);
+            }
+            if (mbc) {
+                mbc->pow(std::span(plain).subspan(b, count), pub.e(), std::span(blocks).subspan(b, count));
+            } else {
+                for (size_t k = b; k < b + count; ++k) blocks[k] = encrypt_block(plain[k], pub);
+            }
+        });
+
         return blocks;
     }
 
-    std::string RSA::decrypt_string(const std::vector<big_int>& cipher_blocks, const PrivKey& priv) const {
+    std::string RSA::decrypt_string(const std::vector<big_int>& cipher_blocks, const PreparedPrivKey& priv) const {
         std::string out;
+        const PrivKey& key = priv.key();
 
         for (const big_int& c : cipher_blocks) {
-            big_int m = decrypt_block(c, priv);
+            if (c < 0 || c >= key.n) {
+                throw std::runtime_error("Ciphertext block out of range (<0 or >= n).");
+            }
+        }
+
+        const bool fixed = framing_ == Framing::Fixed;
+        size_t chunk = 0;
+        if (fixed) {
+            if (priv.byte_length() < 2) throw std::runtime_error("Fixed framing requires a modulus of at least 2 bytes.");
+            chunk = priv.byte_length() - 1;
+            if (cipher_blocks.size() * chunk < frame_trailer_bytes) {
+                throw std::runtime_error("Fixed framing: ciphertext too short for the length trailer.");
+            }
+            out.resize(cipher_blocks.size() * chunk);
+        }
 
-            // rozpakuj big_int na bajty (base-256)
-            std::vector<unsigned char> bytes;
-            big_int temp = m;
+        // Konteksty (CRT albo pojedynczy dla n) zbudowane raz w PreparedPrivKey
+        std::vector<big_int> plain(cipher_blocks.size());
+        const bool batch = cipher_blocks.size() >= 2;
+        const MultiBufferContext* mb_p = batch ? priv.multibuffer_p() : nullptr;
+        const MultiBufferContext* mb_q = batch ? priv.multibuffer_q() : nullptr;
+        const MultiBufferContext* mb_n = batch ? priv.multibuffer_n() : nullptr;
+        std::atomic<bool> malformed{ false };
+        for_each_group(cipher_blocks.size(), [&](size_t b, size_t count) {
+            auto group = std::span(cipher_blocks).subspan(b, count);
+            if (mb_p && mb_q) {
+                // Obie połówki CRT grupy naraz, rekombinacja Garnera na mpz
+                std::array<big_int, mb::lanes> m1, m2;
+                mb_p->pow(group, key.dP, m1);
+                mb_q->pow(group, key.dQ, m2);
+                for (size_t k = 0; k < count; ++k) {
+                    plain[b + k] = crt_combine(m1[k], m2[k], key.p, key.q, key.qInv);
+                }
+            } else if (mb_n) {
+                mb_n->pow(group, key.d, std::span(plain).subspan(b, count));
+            } else {
+                // Klucze wieloczynnikowe i brak SIMD: bloki po kolei (k potęgowań na blok przy CRT)
+                for (size_t k = b; k < b + count; ++k) plain[k] = decrypt_block(cipher_blocks[k], priv);
+            }
 
-            while (temp > 0) {
-                uint32_t byte = (temp.get_ui() & 0xFF);
-                bytes.push_back(static_cast<unsigned char>(byte));
-                temp >>= 8;
+            // Ramka Fixed: każdy blok na swoim miejscu w wyniku, wyrównany do prawej (wiodące zera zostają)
+            if (!fixed) return;
+            for (size_t k = b; k < b + count; ++k) {
+                const mpz_srcptr m = plain[k].get_mpz_t();
+                const size_t bytes = mpz_sgn(m) == 0 ? 0 : (mpz_sizeinbase(m, 2) + 7) / 8;
+                if (bytes > chunk) {
+                    malformed.store(true, std::memory_order_relaxed);
+                    continue;
+                }
+                if (bytes > 0) mpz_export(out.data() + (k + 1) * chunk - bytes, nullptr, 1, 1, 1, 0, m);
             }
+        });
 
-            // Wersja demonstracyjna: jeśli m==0, nie dopisujemy sztucznego '\0'
-            if (!bytes.empty()) {
-                for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
-                    out.push_back(static_cast<char>(*it));
+        if (fixed) {
+            if (malformed.load()) throw std::runtime_error("Fixed framing: decrypted block exceeds k-1 bytes.");
+            std::uint64_t length = 0;
+            for (size_t j = out.size() - frame_trailer_bytes; j < out.size(); ++j) {
+                length = length << 8 | static_cast<unsigned char>(out[j]);
             }
+            if (length > out.size() - frame_trailer_bytes) {
+                throw std::runtime_error("Fixed framing: invalid length trailer.");
+            }
+            out.resize(length);
+            return out;
+        }
+
+        // Bajty bloków big-endian wprost do wyniku: rozmiar liczony raz, potem mpz_export na miejscu.
+        // Wersja demonstracyjna: m == 0 nie daje sztucznego '\0', wiodące zera bloku też znikają
+        size_t total = 0;
+        for (const big_int& m : plain) {
+            if (m != 0) total += (mpz_sizeinbase(m.get_mpz_t(), 2) + 7) / 8;
+        }
+        out.resize(total);
+        size_t pos = 0;
+        for (const big_int& m : plain) {
+            if (m == 0) continue;
+            size_t written = 0;
+            mpz_export(out.data() + pos, &written, 1, 1, 1, 0, m.get_mpz_t());
+            pos += written;
         }
 
         return out;
@@ -2,9 +2,18 @@
 #define RSA_H
 
 #include <gmpxx.h>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "modulus.h"
+#include "prime_pool.h"
+#include "sieve.h"
+
 class UnitTests; // fwd declaration
 
 namespace rsa {
@@ -20,24 +29,124 @@ namespace rsa {
     struct PrivKey {
         big_int n; // ^
         big_int d; // Wykladnik prywatny
+
+        /* Parametry CRT (RFC 8017, sekcja 3.2) - pozwalaja zastapic jedno
+         * potegowanie modulo n dwoma potegowaniami polowy dlugosci.
+         * p == 0 oznacza klucz bez CRT (np. stary plik `d n`) */
+        big_int p;    // Pierwszy czynnik n
+        big_int q;    // Drugi czynnik n
+        big_int dP;   // d mod (p - 1)
+        big_int dQ;   // d mod (q - 1)
+        big_int qInv; // q^-1 mod p
+
+        // Klucz wieloczynnikowy (RFC 8017, sekcja 3.2): trzeci, czwarty, ... czynnik n
+        std::vector<OtherPrimeInfo> others;
+
+        bool has_crt() const { return p != 0 && q != 0; }
+        size_t prime_count() const { return has_crt() ? 2 + others.size() : 0; }
     };
 
+    // Liczba czynnikow pierwszych modulu dla generate_keys (2 = klasyczne RSA)
+    inline constexpr unsigned int max_key_primes = 4;
+
+    /* Od tej dlugosci kandydata (liczby pierwsze kluczy >= 8192 bitow) rundy MR po pierwszej
+     * rozkladane sa na ThreadPool::shared(); pierwsza runda odrzuca prawie wszystkie zlozone */
+    inline constexpr unsigned int parallel_mr_min_bits = 4096;
+
+    // Test pierwszosci kandydatow przy generowaniu kluczy
+    enum class PrimalityTest {
+        MillerRabin, // mr_rounds losowych rund Millera-Rabina (0 -> liczba rund dobrana do dlugosci)
+        BailliePSW   // silny test przy podstawie 2 + silny test Lucasa (parametry Selfridge'a, metoda A)
+    };
+
+    // Podzial tekstu na bloki w encrypt_string / decrypt_string
+    enum class Framing {
+        Legacy, // najdluzszy prefiks z m < n; wiodace zera bloku gina przy deszyfrowaniu
+        Fixed   // zawsze k - 1 bajtow na blok (k = bajty n), na koncu dlugosc tekstu (frame_trailer_bytes, big-endian)
+    };
+
+    inline constexpr unsigned int frame_trailer_bytes = 8;
+
+    class PreparedPubKey;
+    class PreparedPrivKey;
+
     class RSA {
     public:
         RSA();
 
+        // mr_rounds == 0 -> liczba rund dobierana do dlugosci kandydata (mr_rounds_for_bits)
         void generate_keys(unsigned int bits, unsigned int mr_rounds = 25);
 
+        // Liczba watkow szukajacych p i q rownolegle (1 = sekwencyjnie, 0 = wszystkie rdzenie)
+        void set_keygen_threads(unsigned int threads) { keygen_threads_ = threads; }
+
+        /* Liczba czynnikow pierwszych n (2 .. max_key_primes): przy 3-4 czynnikach deszyfrowanie
+         * liczy k potegowan dlugosci n / k zamiast dwoch dlugosci n / 2 */
+        void set_prime_count(unsigned int primes);
+        unsigned int prime_count() const { return prime_count_; }
+
+        // Dlugosci czynnikow w generate_keys: po bits / primes bitow, ostatni dostaje reszte
+        static std::vector<unsigned int> prime_sizes(unsigned int bits, unsigned int primes);
+
+        /* Tryb niskiego opoznienia: obie polowki CRT jednego bloku liczone naraz
+         * (modulo p na stalym watku pomocniczym SpinWorker::shared(), modulo q na wywolujacym) */
+        void set_latency_mode(bool on) { latency_mode_ = on; }
+        bool latency_mode() const { return latency_mode_; }
+
+        /* Framing::Fixed: liczba blokow znana z gory (ceil((dlugosc + 8) / (k - 1))), bufory
+         * alokowane raz, a grupy blokow rozdzielane na ThreadPool::shared() bez sekwencyjnego
+         * dopasowywania prefiksow. Szyfrogram trzeba odszyfrowac w tym samym trybie */
+        void set_framing(Framing framing) { framing_ = framing; }
+        Framing framing() const { return framing_; }
+
+        void set_primality_test(PrimalityTest test) { primality_ = test; }
+        PrimalityTest primality_test() const { return primality_; }
+
+        // Granica filtra wstepnego (iloczyn liczb pierwszych < bound) w is_probable_prime / is_bpsw_prime
+        void set_prefilter_bound(std::uint32_t bound) { prefilter_ = PrimorialFilter::shared(bound); }
+
+        /* Zapas liczb pierwszych: generate_keys zdejmuje z puli p i q o dlugosci pool->bits(),
+         * a gdy pula jest pusta (albo ma inna dlugosc), szuka ich na biezaco */
+        void attach_prime_pool(std::shared_ptr<PrimePool> pool) { pool_ = std::move(pool); }
+        // Watki w tle dopelniajace pule liczbami z search_prime (ten sam test pierwszosci co tutaj)
+        void start_pool_refill(PrimePool& pool, unsigned int threads, unsigned int mr_rounds = 25) const;
+
+        /* Uzupelnienie klucza bez CRT (stary plik `d n`) o p, q, dP, dQ, qInv: n rozkladane
+         * z (e, d) algorytmem probabilistycznym - e * d - 1 = 2^s * t, a losowe g^(t * 2^i)
+         * szybko trafia na nietrywialny pierwiastek z 1 modulo n, ktory zdradza czynnik */
+        PrivKey recover_crt(const PrivKey& priv, const big_int& e) const;
+
         PubKey  get_public_key() const { return pub_; };   
         PrivKey get_private_key() const { return priv_; };
 
+        // Surowe klucze przygotowywane przy kazdym wywolaniu - przy wielu wywolaniach lepiej raz PreparedPubKey / PreparedPrivKey
         big_int encrypt_block(const big_int& m, const PubKey& pub) const;
         big_int decrypt_block(const big_int& c, const PrivKey& priv) const;
 
         std::vector<big_int> encrypt_string(const std::string& message, const PubKey& pub) const;
         std::string decrypt_string(const std::vector<big_int>& cipher_blocks, const PrivKey& priv) const;
 
+        // Klucze z gotowymi kontekstami (prepared_key.h)
+        big_int encrypt_block(const big_int& m, const PreparedPubKey& pub) const;
+        big_int decrypt_block(const big_int& c, const PreparedPrivKey& priv) const;
+
+        std::vector<big_int> encrypt_string(const std::string& message, const PreparedPubKey& pub) const;
+        std::string decrypt_string(const std::vector<big_int>& cipher_blocks, const PreparedPrivKey& priv) const;
+
+        // rounds == 0 -> liczba rund z mr_rounds_for_bits(dlugosc n)
         bool is_probable_prime(const big_int& n, unsigned int rounds = 25) const;
+        bool is_bpsw_prime(const big_int& n) const;
+
+        /* Minimalna liczba rund MR dla losowego kandydata o dlugosci `bits`
+         * (tabela OpenSSL 1.1 BN_prime_checks_for_size; prawdopodobienstwo bledu < 2^-80) */
+        static unsigned int mr_rounds_for_bits(unsigned int bits);
+
+        /* Wiele odwrotnosci naraz (sztuczka Montgomery'ego, jedna inwersja na wywolanie);
+         * rzucaja std::runtime_error, gdy ktorakolwiek odwrotnosc nie istnieje */
+        // result[i] = values[i]^-1 mod m
+        static std::vector<big_int> batch_modinv(std::span<const big_int> values, const big_int& m);
+        // result[i] = a^-1 mod moduli[i] (np. d = e^-1 mod phi dla wielu kluczy)
+        static std::vector<big_int> modinv_many(const big_int& a, std::span<const big_int> moduli);
 
         friend class ::UnitTests;
     private:
@@ -52,10 +161,27 @@ namespace rsa {
         big_int random_bits(unsigned int k) const;
         big_int random_k_bit(unsigned int k) const;
         big_int random_between(const big_int& low, const big_int& high) const;
+        // Rdzenie testow dla nieparzystego n >= granicy filtra, bez malych dzielnikow
+        bool miller_rabin(const big_int& n, unsigned int rounds) const;
+        static bool baillie_psw(const big_int& n);
+
+        /* Test wybrany przez set_primality_test dla kandydata z CandidateSieve
+         * (male dzielniki juz odsiane, wiec bez NWD z primorialem) */
+        bool passes_primality_test(const big_int& n, unsigned int mr_rounds) const;
         big_int generate_prime(unsigned int bits, unsigned int mr_rounds = 25) const;
 
-        unsigned int rng_seed_entropy() const;
-        unsigned int mr_rounds_default_;      
+        // Poszukiwanie z kooperacyjnym przerwaniem; nullopt, gdy zażądano zatrzymania
+        std::optional<big_int> search_prime(unsigned int bits, unsigned int mr_rounds, std::stop_token stop) const;
+        // p i q szukane jednocześnie przez keygen_threads_ wątków (po połowie na każdą liczbę)
+        std::pair<big_int, big_int> generate_prime_pair(unsigned int bits_p, unsigned int bits_q, unsigned int mr_rounds) const;
+
+        unsigned int keygen_threads_ = 1;
+        unsigned int prime_count_ = 2;
+        bool latency_mode_ = false;
+        Framing framing_ = Framing::Legacy;
+        PrimalityTest primality_ = PrimalityTest::MillerRabin;
+        std::shared_ptr<const PrimorialFilter> prefilter_ = PrimorialFilter::shared();
+        std::shared_ptr<PrimePool> pool_;
     };
 }
 
@@ -0,0 +1,135 @@
+#include "sieve.h"
+#include "prime_tables.h"
+#include "residues.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace rsa {
+    using SievePrimes = tables::SmallPrimes<sieve_prime_bound>;
+    static constexpr std::uint32_t table_bound = 1u << 16; // liczby pierwsze z czasu kompilacji dla PrimorialFilter
+    using FilterPrimes = tables::SmallPrimes<table_bound>;
+    using FirstStage = tables::Primorial<1u << 10>;
+
+    // Tablica z czasu kompilacji bez początkowej dwójki
+    std::span<const std::uint32_t> sieve_primes() {
+        return std::span<const std::uint32_t>(SievePrimes::primes).subspan(1);
+    }
+
+    CandidateSieve::CandidateSieve(const big_int& start, unsigned int bits) : start_(start) {
+        mpz_setbit(limit_.get_mpz_t(), bits);
+
+        // Tylko liczby pierwsze mniejsze od kandydata - inaczej odrzucilibyśmy samą liczbę pierwszą
+        auto all = sieve_primes();
+        auto end = all.end();
+        if (bits <= 32) {
+            std::uint64_t min_candidate = std::uint64_t(1) << (bits - 1);
+            end = std::lower_bound(all.begin(), all.end(), min_candidate);
+        }
+        primes_ = all.subspan(0, static_cast<size_t>(end - all.begin()));
+
+        // Reszty startu modulo wszystkie liczby sita naraz (SIMD), potem tylko potrzebny prefiks
+        static const ResidueTable table(all, std::span<const double>(SievePrimes::reciprocal).subspan(1));
+        residues_.resize(all.size());
+        table.reduce(start_, residues_);
+        residues_.resize(primes_.size());
+    }
+
+    bool CandidateSieve::next(big_int& candidate) {
+        while (true) {
+            if (!first_) {
+                if (offset_ > std::numeric_limits<unsigned long>::max() - 2) return false;
+                offset_ += 2;
+                for (size_t i = 0; i < primes_.size(); ++i) {
+                    std::uint32_t r = residues_[i] + 2;
+                    residues_[i] = r >= primes_[i] ? r - primes_[i] : r;
+                }
+            }
+            first_ = false;
+
+            bool survivor = std::find(residues_.begin(), residues_.end(), 0u) == residues_.end();
+            if (!survivor) continue;
+
+            mpz_add_ui(candidate.get_mpz_t(), start_.get_mpz_t(), offset_);
+            return candidate < limit_;
+        }
+    }
+
+    PrimorialFilter::PrimorialFilter(std::uint32_t bound) : bound_(bound) {
+        if (bound < primorial_min_bound || bound > primorial_max_bound) {
+            throw std::runtime_error("PrimorialFilter: bound must be in [64, 2^24].");
+        }
+
+        if (bound <= table_bound) {
+            // Do 2^16 liczby pierwsze biorą się z tablicy z czasu kompilacji
+            auto end = std::lower_bound(FilterPrimes::primes.begin(), FilterPrimes::primes.end(), bound);
+            primes_.assign(FilterPrimes::primes.begin(), end);
+        } else {
+            std::vector<bool> composite(bound, false);
+            for (std::uint32_t i = 2; i < bound; ++i) {
+                if (composite[i]) continue;
+                primes_.push_back(i);
+                for (std::uint64_t j = std::uint64_t(i) * i; j < bound; j += i) composite[j] = true;
+            }
+        }
+
+        // Iloczyn drzewem (pary sąsiadów), żeby mnożyć liczby podobnej długości
+        std::vector<big_int> level(primes_.begin(), primes_.end());
+        while (level.size() > 1) {
+            std::vector<big_int> next((level.size() + 1) / 2);
+            for (size_t i = 0; i + 1 < level.size(); i += 2) next[i / 2] = level[i] * level[i + 1];
+            if (level.size() % 2) next.back() = std::move(level.back());
+            level = std::move(next);
+        }
+        primorial_ = std::move(level.front());
+    }
+
+    std::shared_ptr<const PrimorialFilter> PrimorialFilter::shared(std::uint32_t bound) {
+        static std::mutex mutex;
+        static std::map<std::uint32_t, std::shared_ptr<const PrimorialFilter>> cache;
+
+        std::lock_guard lock(mutex);
+        auto& slot = cache[bound];
+        if (!slot) slot = std::make_shared<const PrimorialFilter>(bound);
+        return slot;
+    }
+
+    int PrimorialFilter::classify(const big_int& n) const {
+        if (n < 2) return 0;
+        if (n < bound_) {
+            return std::binary_search(primes_.begin(), primes_.end(),
+                                      static_cast<std::uint32_t>(n.get_ui())) ? 1 : 0;
+        }
+
+        /* n w jednym słowie: dzielenie próbne przez liczby pierwsze <= sqrt(n) redukcją Barretta
+         * (stałe z tablicy z czasu kompilacji). Dla n < bound^2 wynik jest rozstrzygający. */
+        if (mpz_sizeinbase(n.get_mpz_t(), 2) <= 64 && bound_ <= table_bound) {
+            std::uint64_t x = 0;
+            mpz_export(&x, nullptr, -1, sizeof(x), 0, 0, n.get_mpz_t());
+            for (size_t i = 0; i < primes_.size(); ++i) {
+                const std::uint64_t p = primes_[i];
+                if (p * p > x) return 1;
+                if (FilterPrimes::mod(x, i) == 0) return 0;
+            }
+            return x < std::uint64_t(bound_) * bound_ ? 1 : -1;
+        }
+
+        // Pierwszy etap: mały primorial (p < 2^10, z czasu kompilacji) odsiewa większość złożonych
+        static const big_int first_stage = [] {
+            big_int v;
+            mpz_import(v.get_mpz_t(), FirstStage::limbs, -1, sizeof(std::uint64_t), 0, 0, FirstStage::value.data());
+            return v;
+        }();
+        big_int g;
+        if (bound_ > (1u << 10)) {
+            mpz_gcd(g.get_mpz_t(), n.get_mpz_t(), first_stage.get_mpz_t());
+            if (g != 1) return 0;
+        }
+
+        // NWD zaczyna od primorial mod n (jedno dzielenie), dalej liczy na liczbach długości n
+        mpz_gcd(g.get_mpz_t(), n.get_mpz_t(), primorial_.get_mpz_t());
+        return g == 1 ? -1 : 0;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SIEVE_H
+#define SIEVE_H
+
+#include <gmpxx.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace rsa {
+    using big_int = mpz_class;
+
+    // Nieparzyste male liczby pierwsze 3 .. sieve_prime_bound (tablica z czasu kompilacji, prime_tables.h)
+    inline constexpr std::uint32_t sieve_prime_bound = 1u << 15;
+    std::span<const std::uint32_t> sieve_primes();
+
+    /* Przyrostowe sito kandydatow na liczby pierwsze.
+     * Reszty startu modulo male liczby pierwsze liczone sa raz (wektorowo, ResidueTable),
+     * potem kandydaci start, start + 2, start + 4, ... sprawdzani sa przez aktualizacje
+     * reszt w slowach maszynowych. Do Millera-Rabina trafiaja tylko ocalali kandydaci. */
+    class CandidateSieve {
+    public:
+        // start nieparzysty; kandydaci nie przekrocza `bits` bitow
+        CandidateSieve(const big_int& start, unsigned int bits);
+
+        // Kolejny kandydat bez malych dzielnikow; false, gdy skonczyl sie zakres `bits` bitow
+        bool next(big_int& candidate);
+
+    private:
+        big_int start_;
+        big_int limit_;      // 2^bits
+        unsigned long offset_ = 0; // przesuniecie wzgledem startu (miesci sie w mpz_add_ui)
+        bool first_ = true;
+        std::span<const std::uint32_t> primes_;
+        std::vector<std::uint32_t> residues_; // (start + offset) mod p
+    };
+
+    // Minimum 64: testy MR/Lucas za filtrem zakladaja kandydata wiekszego od parametrow |D| Selfridge'a
+    inline constexpr std::uint32_t primorial_default_bound = 1u << 16;
+    inline constexpr std::uint32_t primorial_min_bound = 64;
+    inline constexpr std::uint32_t primorial_max_bound = 1u << 24;
+
+    /* Filtr wstepny dla kandydatow spoza sita (np. podanych z zewnatrz):
+     * iloczyn wszystkich liczb pierwszych < bound trzymany jako jedna liczba,
+     * kandydat odrzucany jednym NWD(n, primorial) zamiast dzielenia przez kazda z osobna. */
+    class PrimorialFilter {
+    public:
+        explicit PrimorialFilter(std::uint32_t bound = primorial_default_bound);
+
+        // Wspoldzielona instancja dla danej granicy (iloczyn liczony raz na proces)
+        static std::shared_ptr<const PrimorialFilter> shared(std::uint32_t bound = primorial_default_bound);
+
+        std::uint32_t bound() const { return bound_; }
+        const big_int& primorial() const { return primorial_; }
+        std::span<const std::uint32_t> primes() const { return primes_; }
+
+        /* 1 - n jest pierwsza (n < bound z tablicy albo n < bound^2 bez dzielnika <= sqrt(n)),
+         * 0 - n < 2 albo ma dzielnik < bound, -1 - nierozstrzygniete (brak malych dzielnikow) */
+        int classify(const big_int& n) const;
+
+    private:
+        std::uint32_t bound_;
+        std::vector<std::uint32_t> primes_; // 2, 3, 5, ... < bound
+        big_int primorial_;
+    };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef SPIN_WORKER_H
+#define SPIN_WORKER_H
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define RSA_SPIN_PAUSE() _mm_pause()
+#else
+#define RSA_SPIN_PAUSE() std::this_thread::yield()
+#endif
+
+namespace rsa {
+    /* Staly watek pomocniczy dla pary zadan o niskim opoznieniu (np. dwie polowki CRT).
+     * Przekazanie zadania to zapis wskaznika i flagi atomowej - pomocnik czeka na nia
+     * aktywnie (pause), wiec start trwa ulamek mikrosekundy zamiast budzenia watku przez
+     * jadro. Po spin_limit pustych obrotach pomocnik zasypia na atomic::wait.
+     * Gdy pomocnik jest zajety przez inny watek (albo go nie ma), run_pair wykonuje
+     * oba zadania sekwencyjnie u wywolujacego. */
+    class SpinWorker {
+    public:
+        static constexpr unsigned int spin_limit = 1u << 16;
+
+        explicit SpinWorker(bool start = true) {
+            if (start) helper_ = std::jthread([this] { work(); });
+        }
+
+        ~SpinWorker() {
+            if (!helper_.joinable()) return;
+            state_.store(stop, std::memory_order_release);
+            state_.notify_one();
+        }
+
+        SpinWorker(const SpinWorker&) = delete;
+        SpinWorker& operator=(const SpinWorker&) = delete;
+
+        // Wspolny pomocnik procesu; na maszynie z jednym rdzeniem bez watku (spin nie ma sensu)
+        static SpinWorker& shared() {
+            static SpinWorker worker(std::thread::hardware_concurrency() > 1);
+            return worker;
+        }
+
+        bool active() const { return helper_.joinable(); }
+
+        // on_helper() na pomocniku i on_caller() na watku wywolujacym; wraca po obu
+        template <class F, class G>
+        void run_pair(F&& on_helper, G&& on_caller) {
+            std::unique_lock claim(claim_, std::try_to_lock);
+            if (!active() || !claim) {
+                on_helper();
+                on_caller();
+                return;
+            }
+
+            task_ = [](void* arg) { (*static_cast<std::remove_reference_t<F>*>(arg))(); };
+            arg_ = const_cast<void*>(static_cast<const void*>(std::addressof(on_helper)));
+            error_ = nullptr;
+            state_.store(posted, std::memory_order_release);
+            state_.notify_one();
+
+            std::exception_ptr caller_error;
+            try {
+                on_caller();
+            } catch (...) {
+                caller_error = std::current_exception();
+            }
+
+            for (unsigned int spins = 0; state_.load(std::memory_order_acquire) != done;) {
+                if (++spins < spin_limit) RSA_SPIN_PAUSE();
+                else std::this_thread::yield();
+            }
+            state_.store(idle, std::memory_order_relaxed);
+
+            if (caller_error) std::rethrow_exception(caller_error);
+            if (error_) std::rethrow_exception(error_);
+        }
+
+    private:
+        enum : int { idle, posted, done, stop };
+
+        void work() {
+            while (true) {
+                int s = state_.load(std::memory_order_acquire);
+                for (unsigned int spins = 0; s != posted && s != stop && spins < spin_limit; ++spins) {
+                    RSA_SPIN_PAUSE();
+                    s = state_.load(std::memory_order_acquire);
+                }
+                if (s == stop) return;
+                if (s != posted) {
+                    state_.wait(s, std::memory_order_acquire);
+                    continue;
+                }
+
+                try {
+                    task_(arg_);
+                } catch (...) {
+                    error_ = std::current_exception();
+                }
+                state_.store(done, std::memory_order_release);
+            }
+        }
+
+        std::mutex claim_;           // jeden run_pair naraz korzysta z pomocnika
+        std::atomic<int> state_{ idle };
+        void (*task_)(void*) = nullptr;
+        void* arg_ = nullptr;
+        std::exception_ptr error_;   // wyjatek z zadania pomocnika, rzucany dalej w run_pair
+        std::jthread helper_;
+    };
+}
+
+#endif
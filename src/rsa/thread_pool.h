@@ -0,0 +1,113 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace rsa {
+    /* Prosta pula watkow do rownoleglych petli `for`. Watek wywolujacy run() sam tez
+     * pobiera indeksy, wiec zagniezdzone wywolania (np. z watkow generate_prime_pair)
+     * nie moga sie zakleszczyc - w najgorszym razie petla wykona sie sekwencyjnie. */
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned int workers) {
+            for (unsigned int i = 0; i < workers; ++i) {
+                workers_.emplace_back([this](std::stop_token stop) { work(stop); });
+            }
+        }
+
+        ~ThreadPool() {
+            for (auto& w : workers_) w.request_stop();
+            wake_.notify_all();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Wspolna pula procesu: liczba rdzeni - 1 pomocnikow (watek wywolujacy jest ostatnim)
+        static ThreadPool& shared() {
+            static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            return pool;
+        }
+
+        size_t workers() const { return workers_.size(); }
+
+        // fn(0), ..., fn(count - 1) na pomocnikach i watku wywolujacym; wraca po wszystkich
+        void run(size_t count, const std::function<void(size_t)>& fn) {
+            if (count == 0) return;
+
+            auto job = std::make_shared<Job>();
+            job->fn = &fn;
+            job->count = count;
+
+            const size_t helpers = std::min(workers_.size(), count - 1);
+            if (helpers > 0) {
+                std::lock_guard lock(mutex_);
+                for (size_t i = 0; i < helpers; ++i) queue_.push_back(job);
+            }
+            for (size_t i = 0; i < helpers; ++i) wake_.notify_one();
+
+            drain(*job);
+
+            std::unique_lock lock(job->mutex);
+            job->finished.wait(lock, [&] { return job->done == job->count; });
+            if (job->error) std::rethrow_exception(job->error);
+        }
+
+    private:
+        struct Job {
+            const std::function<void(size_t)>* fn = nullptr;
+            size_t count = 0;
+            std::atomic<size_t> next{ 0 };
+
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t done = 0;            // pod mutex
+            std::exception_ptr error;   // pierwszy wyjatek z fn, rzucany dalej w run()
+        };
+
+        static void drain(Job& job) {
+            for (size_t i = job.next++; i < job.count; i = job.next++) {
+                std::exception_ptr error;
+                try {
+                    (*job.fn)(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard lock(job.mutex);
+                if (error && !job.error) job.error = error;
+                if (++job.done == job.count) job.finished.notify_all();
+            }
+        }
+
+        void work(std::stop_token stop) {
+            while (true) {
+                std::shared_ptr<Job> job;
+                {
+                    std::unique_lock lock(mutex_);
+                    if (!wake_.wait(lock, stop, [&] { return !queue_.empty(); })) return;
+                    job = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+                drain(*job);
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable_any wake_;
+        std::deque<std::shared_ptr<Job>> queue_;
+        std::vector<std::jthread> workers_;
+    };
+}
+
+#endif
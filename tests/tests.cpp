@@ -1,8 +1,27 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "../tests/tests.h"
+#include "cli/commands.hpp"
+#include "rsa/cipher_container.h"
+#include "rsa/drbg.h"
+#include "rsa/multibuffer.h"
+#include "rsa/prepared_key.h"
+#include "rsa/prime_pool.h"
+#include "rsa/prime_tables.h"
+#include "rsa/residues.h"
+#include "rsa/spin_worker.h"
+#include "rsa/thread_pool.h"
+#include "rsa/sieve.h"
 
 using big_int = mpz_class;
 
@@ -34,6 +53,70 @@ void UnitTests::test_math() {
         assert(rsa.modinv(7, 26) == 15);
     }
 
+    // NWD Lehmera na dużych liczbach: zgodność z GMP, tożsamość Bézouta, odwrotności
+    {
+        gmp_randclass gen(gmp_randinit_default);
+        gen.seed(20240705);
+        for (unsigned int bits : { 8u, 63u, 64u, 65u, 200u, 1024u, 4096u }) {
+            for (int i = 0; i < 20; ++i) {
+                big_int common = big_int(gen.get_z_bits(bits / 4 + 1)) + 1;
+                big_int a = big_int(gen.get_z_bits(bits)) * (i % 3 ? 1 : common);
+                big_int b = big_int(gen.get_z_bits(bits - i % 5)) * (i % 3 ? 1 : common);
+                if (i % 4 == 1) a = -a;
+                if (i % 4 == 2) b = -b;
+
+                big_int g, x, y, expected;
+                mpz_gcd(expected.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+                assert(rsa.gcd(a, b) == expected);
+                rsa.extended_gcd(a, b, g, x, y);
+                assert(g == expected && a * x + b * y == g);
+
+                if (b > 1 && expected == 1) {
+                    big_int inv = rsa.modinv(a, b);
+                    assert(inv >= 0 && inv < b && (a * inv - 1) % b == 0);
+                }
+            }
+        }
+
+        big_int g, x, y;
+        rsa.extended_gcd(0, 0, g, x, y);
+        assert(g == 0);
+        rsa.extended_gcd(-12, 0, g, x, y);
+        assert(g == 12 && -12 * x == 12);
+
+        bool rejected = false;
+        try { rsa.modinv(6, 9); } catch (const std::runtime_error&) { rejected = true; }
+        assert(rejected);
+    }
+
+    // Odwrotności wsadowe: wiele wartości modulo jednego m i jedna wartość modulo wielu m
+    {
+        gmp_randclass gen(gmp_randinit_default);
+        gen.seed(20240712);
+        big_int m = (big_int(1) << 521) - 1; // liczba pierwsza Mersenne'a
+        std::vector<big_int> values;
+        for (int i = 0; i < 17; ++i) values.push_back(big_int(gen.get_z_bits(600)) + 1);
+        values.push_back(-5);
+        auto inv = rsa::RSA::batch_modinv(values, m);
+        assert(inv.size() == values.size());
+        for (size_t i = 0; i < values.size(); ++i) assert(inv[i] == rsa.modinv(values[i], m));
+        assert(rsa::RSA::batch_modinv(std::vector<big_int>{}, m).empty());
+
+        std::vector<big_int> moduli;
+        for (int i = 0; i < 9; ++i) moduli.push_back(big_int(gen.get_z_bits(256)) * 2 + 2); // parzyste, nie względnie pierwsze
+        moduli.push_back(1);
+        auto many = rsa::RSA::modinv_many(65537, moduli);
+        for (size_t i = 0; i < moduli.size(); ++i) assert(many[i] == rsa.modinv(65537, moduli[i]));
+
+        bool rejected = false;
+        values.push_back(m * 3);
+        try { rsa::RSA::batch_modinv(values, m); } catch (const std::runtime_error&) { rejected = true; }
+        assert(rejected);
+        rejected = false;
+        try { rsa::RSA::modinv_many(6, moduli); } catch (const std::runtime_error&) { rejected = true; }
+        assert(rejected);
+    }
+
     // 3. Potęgowanie Modularne (Modular Exponentiation)
     {
         // 2^10 % 1000 = 1024 % 1000 = 24
@@ -93,6 +176,764 @@ void UnitTests::test_rsa_consistency() {
     assert(original_msg == decrypted);
 }
 
+void UnitTests::test_prepared_keys() {
+    rsa.generate_keys(512);
+
+    auto pub = rsa.get_public_key();
+    auto priv = rsa.get_private_key();
+
+    // Klucze przygotowane raz: te same wyniki co surowe klucze, także bez CRT i dla parzystego n
+    rsa::PreparedPubKey prepared_pub(pub);
+    rsa::PreparedPrivKey prepared_priv(priv);
+    assert(prepared_pub.byte_length() == 64 && prepared_pub.max_block_bytes() == 63);
+    assert(rsa.encrypt_block(1234, prepared_pub) == rsa.encrypt_block(1234, pub));
+    std::string long_msg(1000, 'r');
+    auto prepared_blocks = rsa.encrypt_string(long_msg, prepared_pub);
+    assert(prepared_blocks == rsa.encrypt_string(long_msg, pub));
+    assert(rsa.decrypt_string(prepared_blocks, prepared_priv) == long_msg);
+
+    // Pojedyncze bloki (surowe klucze) bez kontekstów SIMD, te same wyniki
+    rsa::PreparedPubKey single_pub(pub, false);
+    rsa::PreparedPrivKey single_priv(priv, false);
+    assert(!single_pub.multibuffer() && single_pub.context());
+    assert(!single_priv.multibuffer_p() && !single_priv.multibuffer_q() && single_priv.crt());
+    assert(rsa.decrypt_string(prepared_blocks, single_priv) == long_msg);
+    assert(rsa.encrypt_string(long_msg, single_pub) == prepared_blocks);
+
+    rsa::PrivKey legacy;
+    legacy.n = priv.n;
+    legacy.d = priv.d;
+    rsa::PreparedPrivKey prepared_legacy(legacy);
+    assert(!prepared_legacy.crt() && prepared_legacy.context());
+    assert(rsa.decrypt_string(prepared_blocks, prepared_legacy) == long_msg);
+
+    for (unsigned int bits : { 9u, 16u, 17u, 24u, 25u }) {
+        big_int n = big_int(1) << (bits - 1);
+        for (big_int k : { big_int(n), big_int(n + 1), big_int(2 * n - 1) }) {
+            unsigned int expected = 1;
+            big_int limit = 256;
+            while (limit * 256 <= k) { limit *= 256; ++expected; }
+            assert(rsa::PreparedPubKey(rsa::PubKey{ k, 3 }).max_block_bytes() == expected);
+        }
+    }
+    rsa::PubKey even{ 1000, 3 };
+    assert(rsa.encrypt_block(7, rsa::PreparedPubKey(even)) == 343);
+}
+
+void UnitTests::test_framing() {
+    rsa.generate_keys(512);
+
+    auto pub = rsa.get_public_key();
+    auto priv = rsa.get_private_key();
+    rsa::PreparedPubKey prepared_pub(pub);
+    rsa::PreparedPrivKey prepared_priv(priv);
+    rsa::PrivKey legacy;
+    legacy.n = priv.n;
+    legacy.d = priv.d;
+    rsa::PreparedPrivKey prepared_legacy(legacy);
+    std::string long_msg(1000, 'r');
+
+    // Pakowanie bajtów big-endian: pełny zakres wartości bajtu (bez zera na początku bloku)
+    std::string binary;
+    for (int i = 0; i < 700; ++i) binary.push_back(static_cast<char>(1 + i % 255));
+    auto binary_blocks = rsa.encrypt_string(binary, prepared_pub);
+    assert(binary_blocks.size() == (binary.size() + 62) / 63);
+    big_int first;
+    mpz_import(first.get_mpz_t(), 63, 1, 1, 1, 0, binary.data());
+    assert(rsa.decrypt_block(binary_blocks[0], prepared_priv) == first);
+    assert(rsa.decrypt_string(binary_blocks, prepared_priv) == binary);
+    auto legacy_blocks = rsa.encrypt_string(long_msg, prepared_pub);
+
+    // Ramka Fixed: k - 1 = 63 bajty na blok + 8 bajtów długości, wiodące zera i puste teksty przechodzą
+    rsa.set_framing(rsa::Framing::Fixed);
+    std::string zeros("\0\0\0abc\0", 7);
+    for (const std::string& msg : { std::string(), std::string("x"), std::string(55, 'a'), std::string(56, 'b'),
+                                    std::string(63, 'c'), zeros, binary, long_msg }) {
+        auto fixed_blocks = rsa.encrypt_string(msg, prepared_pub);
+        assert(fixed_blocks.size() == (msg.size() + rsa::frame_trailer_bytes + 62) / 63);
+        assert(rsa.decrypt_string(fixed_blocks, prepared_priv) == msg);
+        assert(rsa.decrypt_string(fixed_blocks, prepared_legacy) == msg);
+    }
+    auto zero_blocks = rsa.encrypt_string(std::string(100, '\0'), pub);
+    assert(rsa.decrypt_block(zero_blocks[0], priv) == 0);
+    assert(rsa.decrypt_string(zero_blocks, priv) == std::string(100, '\0'));
+
+    // Modul 2-bajtowy (n = 17 * 19): jeden bajt na blok, długość rozłożona na 8 bloków
+    rsa::PubKey tiny_pub{ 323, 5 };
+    rsa::PrivKey tiny_priv;
+    tiny_priv.n = 323;
+    tiny_priv.d = 173;
+    auto tiny_blocks = rsa.encrypt_string(zeros, tiny_pub);
+    assert(tiny_blocks.size() == zeros.size() + rsa::frame_trailer_bytes);
+    assert(rsa.decrypt_string(tiny_blocks, tiny_priv) == zeros);
+
+    // Szyfrogram w starym podziale nie ma poprawnej długości na końcu
+    bool rejected = false;
+    try { rsa.decrypt_string(legacy_blocks, prepared_priv); }
+    catch (const std::runtime_error&) { rejected = true; }
+    assert(rejected);
+    rsa.set_framing(rsa::Framing::Legacy);
+}
+
+void UnitTests::test_cipher_container() {
+    rsa.generate_keys(512);
+
+    auto pub = rsa.get_public_key();
+    auto priv = rsa.get_private_key();
+
+    // Kontener binarny: 32 bajty nagłówka + bloki po k = 64 bajty, podział na bloki w nagłówku
+    assert(rsa::key_fingerprint(0) == 0xcbf29ce484222325ull && rsa::key_fingerprint(0x61) == 0xaf63dc4c8601ec8cull);
+    std::string binary;
+    for (int i = 0; i < 700; ++i) binary.push_back(static_cast<char>(i % 256));
+    rsa.set_framing(rsa::Framing::Fixed);
+    auto fixed_blocks = rsa.encrypt_string(binary, pub);
+    rsa.set_framing(rsa::Framing::Legacy);
+    std::string packed = rsa::pack_cipher_blocks(fixed_blocks, pub.n, rsa::Framing::Fixed);
+    assert(rsa::is_cipher_container(packed) && !rsa::is_cipher_container("123 456"));
+    assert(packed.size() == rsa::cipher_header_bytes + fixed_blocks.size() * 64);
+    rsa::CipherHeader header;
+    assert(rsa::unpack_cipher_blocks(packed, priv.n, &header) == fixed_blocks);
+    assert(header.framing == rsa::Framing::Fixed && header.modulus_bytes == 64 && header.block_count == fixed_blocks.size());
+    assert(header.fingerprint == rsa::key_fingerprint(pub.n));
+
+    std::string decimal;
+    for (const big_int& c : fixed_blocks) decimal += c.get_str() + " ";
+    assert(packed.size() * 2 < decimal.size());
+
+    // Blok z wiodącym zerowym bajtem zachowuje stałą szerokość
+    std::vector<big_int> small_blocks{ big_int(0), big_int(1), big_int(priv.n - 1) };
+    assert(rsa::unpack_cipher_blocks(rsa::pack_cipher_blocks(small_blocks, pub.n, rsa::Framing::Legacy), priv.n) == small_blocks);
+
+    auto rejects = [&](std::string data, const big_int& n) {
+        try { rsa::unpack_cipher_blocks(data, n); } catch (const std::runtime_error&) { return true; }
+        return false;
+    };
+    assert(rejects(packed, priv.n + 2));                           // inny klucz
+    assert(rejects(packed.substr(0, packed.size() - 1), priv.n)); // obcięty plik
+    assert(rejects(packed + '\0', priv.n));
+    std::string future = packed;
+    future[9] = 2;                                                // nieznana wersja
+    assert(rejects(future, priv.n));
+    std::string reserved = packed;
+    reserved[11] = 1;                                             // niezerowy bajt zarezerwowany
+    assert(rejects(reserved, priv.n));
+}
+
+void UnitTests::test_crt() {
+    rsa.generate_keys(512);
+
+    auto pub = rsa.get_public_key();
+    auto priv = rsa.get_private_key();
+    assert(priv.has_crt());
+    assert(priv.p * priv.q == priv.n);
+
+    // Klucz bez parametrów CRT (jak stary plik `d n`) musi dawać ten sam wynik
+    rsa::PrivKey legacy;
+    legacy.n = priv.n;
+    legacy.d = priv.d;
+
+    for (big_int m : { big_int(0), big_int(1), big_int(42), priv.q, big_int(priv.n - 1) }) {
+        big_int c = rsa.encrypt_block(m, pub);
+        assert(rsa.decrypt_block(c, priv) == m);
+        assert(rsa.decrypt_block(c, legacy) == m);
+    }
+
+    // Odzyskanie p i q z (n, e, d) dla klucza bez CRT
+    {
+        rsa::PrivKey upgraded = rsa.recover_crt(legacy, pub.e);
+        assert(upgraded.has_crt() && upgraded.p * upgraded.q == priv.n);
+        assert((upgraded.p == priv.p && upgraded.q == priv.q) || (upgraded.p == priv.q && upgraded.q == priv.p));
+        assert(upgraded.dP == priv.d % (upgraded.p - 1) && (upgraded.q * upgraded.qInv) % upgraded.p == 1);
+        assert(rsa.decrypt_block(rsa.encrypt_block(4242, pub), upgraded) == 4242);
+
+        bool rejected = false;
+        try { rsa.recover_crt(legacy, pub.e + 2); } catch (const std::runtime_error&) { rejected = true; }
+        assert(rejected);
+    }
+
+    // `keys upgrade` w miejscu: klucz z p i q zachowuje prawa 0600 starego pliku, bez pliku .tmp
+    {
+        namespace fs = std::filesystem;
+        const fs::path key_path = fs::temp_directory_path() / ("rsa_test_" + std::to_string(rsa::ChaCha20Drbg::thread_instance()()) + ".key");
+        std::ofstream(key_path) << legacy.d.get_str() << " " << legacy.n.get_str() << "\n";
+        const fs::perms owner_only = fs::perms::owner_read | fs::perms::owner_write;
+        fs::permissions(key_path, owner_only);
+
+        const fs::path pub_path = key_path.string() + ".pub";
+        std::ofstream(pub_path) << pub.e.get_str() << " " << pub.n.get_str() << "\n";
+
+        cli::keys_args_t args;
+        args.action = "upgrade";
+        args.priv_key_path = key_path.string();
+        args.pub_key_path = pub_path.string();
+        assert(cli::cmd_keys(args));
+        assert(fs::status(key_path).permissions() == owner_only);
+        assert(!fs::exists(key_path.string() + ".tmp"));
+
+        std::ifstream upgraded_file(key_path);
+        assert(cli::read_priv_key(upgraded_file).has_crt());
+        fs::remove(key_path);
+        fs::remove(pub_path);
+    }
+
+    // Połówki CRT różnej szerokości (p i q w różnych FixedUInt oraz ścieżka ogólna)
+    gmp_randclass gen(gmp_randinit_default);
+    gen.seed(777);
+    for (auto [pbits, qbits] : { std::pair{ 1024u, 1024u }, std::pair{ 1000u, 1100u }, std::pair{ 4200u, 300u } }) {
+        big_int p, q;
+        big_int rp = gen.get_z_bits(pbits), rq = gen.get_z_bits(qbits);
+        mpz_setbit(rp.get_mpz_t(), pbits - 1);
+        mpz_setbit(rq.get_mpz_t(), qbits - 1);
+        mpz_nextprime(p.get_mpz_t(), rp.get_mpz_t());
+        mpz_nextprime(q.get_mpz_t(), rq.get_mpz_t());
+
+        big_int n = p * q;
+        big_int phi = (p - 1) * (q - 1);
+        big_int e = 65537;
+        if (rsa.gcd(e, phi) != 1) continue;
+        big_int d = rsa.modinv(e, phi);
+
+        rsa::CrtContext crt(p, q, d % (p - 1), d % (q - 1), rsa.modinv(q, p));
+        for (int i = 0; i < 3; ++i) {
+            big_int m = gen.get_z_range(n);
+            big_int c;
+            mpz_powm(c.get_mpz_t(), m.get_mpz_t(), e.get_mpz_t(), n.get_mpz_t());
+            assert(crt.decrypt(c) == m);
+        }
+    }
+
+    // Klucze wieloczynnikowe (RFC 8017): 3 i 4 czynniki, Garner po kolejnych czynnikach
+    for (unsigned int primes : { 3u, 4u }) {
+        rsa::RSA multi;
+        multi.set_prime_count(primes);
+        multi.generate_keys(768);
+        auto mpub = multi.get_public_key();
+        auto mpriv = multi.get_private_key();
+        assert(mpriv.prime_count() == primes);
+        assert(mpz_sizeinbase(mpub.n.get_mpz_t(), 2) == 768);
+
+        big_int product = mpriv.p * mpriv.q;
+        for (const auto& o : mpriv.others) {
+            assert(o.d == mpriv.d % (o.r - 1));
+            assert((product * o.t - 1) % o.r == 0);
+            product *= o.r;
+        }
+        assert(product == mpriv.n);
+
+        for (big_int m : { big_int(0), big_int(1), big_int(42), mpriv.others.back().r, big_int(mpriv.n - 1) }) {
+            big_int c = multi.encrypt_block(m, mpub);
+            assert(multi.decrypt_block(c, mpriv) == m);
+        }
+        std::string msg(300, 'x');
+        assert(multi.decrypt_string(multi.encrypt_string(msg, mpub), mpriv) == msg);
+    }
+
+    // Długość n dokładnie taka, jak żądana, także przy czynnikach różnej długości (1030 / 4)
+    for (unsigned int primes : { 2u, 3u, 4u }) {
+        rsa::RSA exact;
+        exact.set_prime_count(primes);
+        for (int i = 0; i < 8; ++i) {
+            exact.generate_keys(1030, 0);
+            assert(mpz_sizeinbase(exact.get_public_key().n.get_mpz_t(), 2) == 1030);
+        }
+    }
+
+    bool rejected = false;
+    try { rsa.set_prime_count(5); } catch (const std::runtime_error&) { rejected = true; }
+    assert(rejected);
+
+    // Tryb niskiego opóźnienia: połówki CRT na pomocniku (także przy jednym rdzeniu - wtedy tylko wolniej)
+    {
+        rsa::SpinWorker helper;
+        assert(helper.active());
+        rsa::CrtContext crt(priv.p, priv.q, priv.dP, priv.dQ, priv.qInv);
+        for (int i = 0; i < 50; ++i) {
+            big_int m = big_int(i) * 1000003 + 7;
+            assert(crt.decrypt(rsa.encrypt_block(m, pub), &helper) == m);
+        }
+
+        int order = 0;
+        bool thrown = false;
+        try {
+            helper.run_pair([&] { throw std::runtime_error("helper"); }, [&] { order = 1; });
+        } catch (const std::runtime_error&) { thrown = true; }
+        assert(thrown && order == 1);
+
+        rsa::RSA fast;
+        fast.set_latency_mode(true);
+        assert(fast.decrypt_block(fast.encrypt_block(99, pub), priv) == 99);
+        assert(fast.decrypt_string(fast.encrypt_string("latency", pub), priv) == "latency");
+    }
+}
+
+void UnitTests::test_montgomery() {
+    // Porównanie z mpz_powm z GMP dla modułów o różnej liczbie limbów
+    gmp_randclass gen(gmp_randinit_default);
+    gen.seed(12345);
+
+    for (unsigned int bits : { 3u, 64u, 65u, 127u, 512u, 1031u, 2048u }) {
+        big_int n = gen.get_z_bits(bits);
+        mpz_setbit(n.get_mpz_t(), bits - 1);
+        mpz_setbit(n.get_mpz_t(), 0);
+
+        rsa::MontgomeryContext ctx(n);
+        for (int i = 0; i < 8; ++i) {
+            big_int base = gen.get_z_bits(bits + 8); // także podstawy >= n
+            big_int exp = gen.get_z_bits(bits);
+            big_int expected;
+            mpz_powm(expected.get_mpz_t(), base.get_mpz_t(), exp.get_mpz_t(), n.get_mpz_t());
+
+            assert(ctx.pow(base, exp) == expected);
+            assert(rsa.modexp(base, exp, n) == expected);
+            assert(ctx.from_mont(ctx.to_mont(base)) == base % n);
+        }
+
+        // Wykładniki publiczne obsługiwane łańcuchami dodawania
+        for (unsigned long e : { 3ul, 17ul, 65537ul }) {
+            big_int base = gen.get_z_bits(bits);
+            big_int expected;
+            mpz_powm_ui(expected.get_mpz_t(), base.get_mpz_t(), e, n.get_mpz_t());
+            assert(ctx.pow(base, e) == expected);
+        }
+    }
+
+    // Stała szerokość (FixedUInt) i wybór kontekstu po rozmiarze modułu
+    for (unsigned int bits : { 100u, 512u, 1000u, 1536u, 2048u, 3071u, 4096u, 4200u }) {
+        big_int n = gen.get_z_bits(bits);
+        mpz_setbit(n.get_mpz_t(), bits - 1);
+        mpz_setbit(n.get_mpz_t(), 0);
+
+        rsa::ModulusContext ctx(n);
+        for (int i = 0; i < 3; ++i) {
+            big_int base = gen.get_z_bits(bits - 1);
+            big_int exp = gen.get_z_bits(bits);
+            big_int expected;
+            mpz_powm(expected.get_mpz_t(), base.get_mpz_t(), exp.get_mpz_t(), n.get_mpz_t());
+            assert(ctx.pow(base, exp) == expected);
+        }
+    }
+}
+
+void UnitTests::test_multibuffer() {
+    gmp_randclass gen(gmp_randinit_default);
+    gen.seed(4242);
+
+    // Jądro wykryte w czasie wykonania i przenośne jądro skalarne muszą dawać wyniki mpz_powm
+    for (unsigned int bits : { 61u, 256u, 1024u, 2048u }) {
+        big_int n = gen.get_z_bits(bits);
+        mpz_setbit(n.get_mpz_t(), bits - 1);
+        mpz_setbit(n.get_mpz_t(), 0);
+
+        std::vector<big_int> bases(rsa::mb::lanes - 1); // niepełna grupa
+        for (auto& b : bases) b = gen.get_z_bits(bits + 4);
+        big_int exp = gen.get_z_bits(bits);
+
+        for (auto kernel : { rsa::mb::detect_kernel(), rsa::mb::Kernel::Scalar }) {
+            rsa::MultiBufferContext ctx(n, kernel);
+            for (const big_int& e : { exp, big_int(65537) }) {
+                std::vector<big_int> out(bases.size());
+                ctx.pow(bases, e, out);
+                for (size_t i = 0; i < bases.size(); ++i) {
+                    big_int expected;
+                    mpz_powm(expected.get_mpz_t(), bases[i].get_mpz_t(), e.get_mpz_t(), n.get_mpz_t());
+                    assert(out[i] == expected);
+                }
+            }
+        }
+    }
+
+    // Wiele bloków w encrypt_string / decrypt_string (grupy SIMD, z CRT i bez)
+    rsa.generate_keys(512);
+    auto pub = rsa.get_public_key();
+    auto priv = rsa.get_private_key();
+    rsa::PrivKey legacy;
+    legacy.n = priv.n;
+    legacy.d = priv.d;
+
+    std::string msg;
+    for (int i = 0; i < 1000; ++i) msg.push_back(static_cast<char>('a' + i % 26));
+    auto blocks = rsa.encrypt_string(msg, pub);
+    assert(blocks.size() > rsa::mb::lanes);
+    assert(rsa.decrypt_string(blocks, priv) == msg);
+    assert(rsa.decrypt_string(blocks, legacy) == msg);
+}
+
+void UnitTests::test_sieve() {
+    // Reszty modulo wszystkie liczby sita: każde dostępne jądro zgodne z mpz_fdiv_ui
+    {
+        rsa::ResidueTable table(rsa::sieve_primes());
+        gmp_randclass gen(gmp_randinit_default);
+        gen.seed(20240611);
+        for (unsigned int bits : { 0u, 1u, 31u, 64u, 65u, 1024u, 2048u, 4096u }) {
+            big_int n = bits ? big_int(gen.get_z_bits(bits)) : big_int(0);
+            if (bits == 64) n = (big_int(1) << 64) - 1;
+            for (auto kernel : { rsa::residue::Kernel::Portable, rsa::residue::Kernel::Avx2, rsa::residue::Kernel::Avx512 }) {
+                if (kernel > rsa::residue::detect_kernel()) continue;
+                std::vector<std::uint32_t> out(table.primes().size());
+                table.reduce(n, out, kernel);
+                for (size_t i = 0; i < out.size(); ++i) {
+                    assert(out[i] == mpz_fdiv_ui(n.get_mpz_t(), table.primes()[i]));
+                }
+            }
+        }
+    }
+
+    // Ocalali kandydaci nie mają małych dzielników i rosną co 2
+    big_int start = (big_int(1) << 127) + 1;
+    rsa::CandidateSieve sieve(start, 128);
+    big_int prev = 0, cand;
+    for (int i = 0; i < 100; ++i) {
+        assert(sieve.next(cand));
+        assert(cand > prev && cand % 2 == 1);
+        for (std::uint32_t p : rsa::sieve_primes()) assert(cand % p != 0);
+        prev = cand;
+    }
+
+    // Koniec zakresu bitów kończy sito
+    rsa::CandidateSieve tail((big_int(1) << 64) - 59, 64);
+    while (tail.next(cand)) assert(cand < (big_int(1) << 64));
+
+    // Równoległe szukanie p i q (więcej wątków niż rdzeni też musi działać)
+    rsa::RSA parallel;
+    parallel.set_keygen_threads(5);
+    parallel.generate_keys(512);
+    auto priv = parallel.get_private_key();
+    assert(priv.p != priv.q && priv.p * priv.q == priv.n);
+    assert(mpz_probab_prime_p(priv.p.get_mpz_t(), 30) != 0);
+    assert(mpz_probab_prime_p(priv.q.get_mpz_t(), 30) != 0);
+    assert(parallel.decrypt_block(parallel.encrypt_block(1234, parallel.get_public_key()), priv) == 1234);
+
+    // Małe rozmiary: liczby pierwsze z tablicy nie mogą być odrzucane same przez siebie
+    for (unsigned int bits : { 2u, 3u, 5u, 16u, 17u, 64u, 256u }) {
+        big_int p = rsa.generate_prime(bits);
+        assert(mpz_sizeinbase(p.get_mpz_t(), 2) == bits);
+        assert(mpz_probab_prime_p(p.get_mpz_t(), 30) != 0);
+    }
+}
+
+void UnitTests::test_drbg() {
+    // RFC 8439, 2.3.2: klucz 00..1f, licznik 1, nonce 00000009 0000004a 00000000
+    std::array<std::uint8_t, 32> key;
+    for (size_t i = 0; i < key.size(); ++i) key[i] = static_cast<std::uint8_t>(i);
+    rsa::ChaCha20Drbg drbg(key, 1 | (std::uint64_t(0x09000000) << 32), 0x4a000000);
+
+    std::array<std::uint8_t, 64> block;
+    drbg.fill(block.data(), block.size());
+    const std::uint8_t expected[16] = { 0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+                                        0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4 };
+    assert(std::equal(std::begin(expected), std::end(expected), block.begin()));
+    assert(block[60] == 0xa2 && block[61] == 0x50 && block[62] == 0x3c && block[63] == 0x4e);
+
+    // random_bits: nigdy więcej niż k bitów, przy wielu losowaniach także dokładnie k
+    for (unsigned int k : { 1u, 63u, 64u, 65u, 1000u }) {
+        bool hit_top = false;
+        for (int i = 0; i < 64; ++i) {
+            big_int r = rsa.random_bits(k);
+            assert(r >= 0 && mpz_sizeinbase(r.get_mpz_t(), 2) <= k);
+            hit_top = hit_top || mpz_tstbit(r.get_mpz_t(), k - 1);
+        }
+        assert(hit_top);
+    }
+}
+
+void UnitTests::test_primality() {
+    // Silne pseudopierwsze przy podstawie 2 (bez dzielników <= 47) - Lucas musi je odrzucić
+    for (unsigned long n : { 3215031751ul, 2152302898747ul, 3474749660383ul, 341550071728321ul }) {
+        assert(!rsa.is_bpsw_prime(n));
+    }
+
+    // Zgodność z GMP na przedziale (kwadraty, iloczyny małych liczb, liczby pierwsze)
+    for (unsigned long n = 0; n < 20000; ++n) {
+        bool expected = mpz_probab_prime_p(big_int(n).get_mpz_t(), 30) != 0;
+        assert(rsa.is_bpsw_prime(n) == expected);
+    }
+    for (unsigned long n = 1000001; n < 1040001; n += 2) {
+        bool expected = mpz_probab_prime_p(big_int(n).get_mpz_t(), 30) != 0;
+        assert(rsa.is_bpsw_prime(n) == expected);
+    }
+
+    // Liczby Mersenne'a 2^521 - 1, 2^607 - 1 (pierwsze) i 2^523 - 1 (złożona)
+    assert(rsa.is_bpsw_prime((big_int(1) << 521) - 1));
+    assert(rsa.is_bpsw_prime((big_int(1) << 607) - 1));
+    assert(!rsa.is_bpsw_prime((big_int(1) << 523) - 1));
+    big_int p = (big_int(1) << 521) - 1, q = (big_int(1) << 607) - 1;
+    assert(!rsa.is_bpsw_prime(p * q));
+    assert(!rsa.is_bpsw_prime(q * q));
+
+    // Tabela rund OpenSSL 1.1 (błąd < 2^-80): progi, nierosnąca z długością; 0 rund -> tabela
+    for (auto [bits, rounds] : { std::pair{ 54u, 34u }, std::pair{ 55u, 27u }, std::pair{ 307u, 27u }, std::pair{ 308u, 8u },
+                                 std::pair{ 347u, 7u }, std::pair{ 400u, 6u }, std::pair{ 476u, 5u }, std::pair{ 1344u, 5u },
+                                 std::pair{ 1345u, 4u }, std::pair{ 3746u, 4u }, std::pair{ 3747u, 3u } }) {
+        assert(rsa::RSA::mr_rounds_for_bits(bits) == rounds);
+    }
+    for (unsigned int bits = 2; bits < 5000; ++bits) {
+        assert(rsa::RSA::mr_rounds_for_bits(bits) >= rsa::RSA::mr_rounds_for_bits(bits + 1));
+    }
+    assert(rsa.is_probable_prime(q, 0) && !rsa.is_probable_prime(p * q, 0));
+
+    // Generowanie kluczy w trybie BPSW i w trybie z rundami dobieranymi do długości
+    for (auto test : { rsa::PrimalityTest::BailliePSW, rsa::PrimalityTest::MillerRabin }) {
+        rsa::RSA engine;
+        engine.set_primality_test(test);
+        engine.generate_keys(512, 0);
+        auto priv = engine.get_private_key();
+        assert(mpz_probab_prime_p(priv.p.get_mpz_t(), 30) != 0);
+        assert(mpz_probab_prime_p(priv.q.get_mpz_t(), 30) != 0);
+        assert(engine.decrypt_block(engine.encrypt_block(4321, engine.get_public_key()), priv) == 4321);
+    }
+
+    // Filtr primorialowy: odczyt z tablicy poniżej granicy, NWD powyżej
+    rsa::PrimorialFilter filter(1000);
+    assert(filter.primes().size() == 168 && filter.primes().back() == 997);
+    assert(filter.classify(0) == 0 && filter.classify(1) == 0 && filter.classify(2) == 1);
+    assert(filter.classify(997) == 1 && filter.classify(999) == 0);
+    assert(filter.classify(big_int(1009) * 1013) == -1);
+    assert(filter.classify(big_int(991) * ((big_int(1) << 521) - 1)) == 0);
+    assert(filter.classify((big_int(1) << 521) - 1) == -1);
+    assert(filter.classify(big_int(997) * 991) == 0 && filter.classify(999983) == 1);
+    assert(rsa::PrimorialFilter::shared(1000) == rsa::PrimorialFilter::shared(1000));
+
+    // Tablice z czasu kompilacji zgodne z sitem i iloczynem liczonym w czasie wykonania
+    {
+        using Small = rsa::tables::SmallPrimes<1u << 16>;
+        static_assert(Small::count == 6542 && Small::primes[0] == 2 && Small::primes[Small::count - 1] == 65521);
+        auto runtime = rsa::PrimorialFilter::shared(1u << 16)->primes();
+        assert(std::equal(runtime.begin(), runtime.end(), Small::primes.begin(), Small::primes.end()));
+        for (std::uint64_t x : { 0ull, 1ull, 65520ull, 0xFFFFFFFFFFFFFFFFull, 0x8000000000000001ull }) {
+            for (size_t i = 0; i < Small::count; i += 97) assert(Small::mod(x, i) == x % Small::primes[i]);
+        }
+
+        using Small10 = rsa::tables::Primorial<1u << 10>;
+        big_int value, expected = 1;
+        mpz_import(value.get_mpz_t(), Small10::limbs, -1, sizeof(std::uint64_t), 0, 0, Small10::value.data());
+        rsa::PrimorialFilter first_stage(1u << 10);
+        for (std::uint32_t p : first_stage.primes()) expected *= p;
+        assert(value == first_stage.primorial());
+        assert(value == expected);
+    }
+
+    // Kandydaci spoza sita przy różnych granicach filtra dają ten sam wynik co GMP
+    for (std::uint32_t bound : { 64u, 1u << 10, 1u << 16, 1u << 20 }) {
+        rsa::RSA engine;
+        engine.set_prefilter_bound(bound);
+        for (unsigned long n = 0; n < 3000; ++n) {
+            bool expected = mpz_probab_prime_p(big_int(n).get_mpz_t(), 30) != 0;
+            assert(engine.is_probable_prime(n) == expected && engine.is_bpsw_prime(n) == expected);
+        }
+    }
+
+    bool rejected = false;
+    try { rsa::PrimorialFilter too_small(10); } catch (const std::runtime_error&) { rejected = true; }
+    assert(rejected);
+}
+
+void UnitTests::test_prime_pool() {
+    namespace fs = std::filesystem;
+    const fs::path file = fs::temp_directory_path() / ("rsa_test_" + std::to_string(rsa::ChaCha20Drbg::thread_instance()()) + ".pool");
+
+    {
+        auto pool = std::make_shared<rsa::PrimePool>(file, 256, 4);
+        assert(pool->capacity() == 4 && pool->size() == 0 && !pool->pop());
+
+        // Drugie mapowanie tego samego pliku widzi te same sloty (jak inny proces)
+        rsa::PrimePool other(file, 256, 100);
+        assert(other.capacity() == 4);
+
+        big_int p = rsa.generate_prime(256);
+        assert(pool->push(p) && other.size() == 1);
+        assert(other.pop() == p && pool->size() == 0);
+
+        // Dopełnianie w tle aż do pojemności
+        rsa.start_pool_refill(*pool, 2);
+        while (pool->size() < pool->capacity()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        pool->stop_refill();
+        assert(pool->size() == 4 && !pool->push(p) && pool->refill_added() == 4 && !pool->refill_error());
+
+        // Błąd źródła nie zabija procesu: wątek kończy pracę, wyjątek czeka w refill_error()
+        assert(pool->pop());
+        pool->start_refill([](std::stop_token) -> std::optional<big_int> { throw std::runtime_error("source"); }, 2);
+        while (!pool->refill_error()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pool->stop_refill();
+        assert(pool->refill_added() == 0 && pool->size() == 3);
+        assert(pool->push(p));
+
+        // generate_keys zdejmuje dwie liczby z puli
+        rsa::RSA engine;
+        engine.attach_prime_pool(pool);
+        engine.generate_keys(512);
+        auto priv = engine.get_private_key();
+        assert(pool->size() == 2);
+        assert(mpz_probab_prime_p(priv.p.get_mpz_t(), 30) != 0 && mpz_probab_prime_p(priv.q.get_mpz_t(), 30) != 0);
+        assert(engine.decrypt_block(engine.encrypt_block(99, engine.get_public_key()), priv) == 99);
+
+        // Pusta pula -> wyszukiwanie na bieżąco
+        while (pool->pop()) {}
+        engine.generate_keys(512);
+        assert(engine.get_private_key().p * engine.get_private_key().q == engine.get_public_key().n);
+
+        bool rejected = false;
+        try { rsa::PrimePool wrong(file, 512, 4); } catch (const std::runtime_error&) { rejected = true; }
+        assert(rejected);
+    }
+
+    // Pula jednej długości obsłuży klucz tylko przy równych czynnikach (4096 / 3: 1365, 1365, 1366)
+    {
+        assert((rsa::RSA::prime_sizes(4096, 3) == std::vector<unsigned int>{ 1365, 1365, 1366 }));
+        assert(cli::pool_prime_bits(3072, 3) == 1024 && cli::pool_prime_bits(2048, 2) == 1024);
+        for (auto [bits, primes] : { std::pair{ 4096, 3 }, std::pair{ 2049, 2 }, std::pair{ 1030, 4 } }) {
+            bool rejected = false;
+            try { cli::pool_prime_bits(bits, primes); } catch (const std::runtime_error&) { rejected = true; }
+            assert(rejected);
+        }
+    }
+
+    // Zapas przetrwał zamknięcie pliku
+    {
+        rsa::PrimePool pool(file, 256, 4);
+        big_int p = rsa.generate_prime(256);
+        assert(pool.size() == 0 && pool.push(p));
+    }
+    {
+        rsa::PrimePool pool(file, 256, 4);
+        assert(pool.size() == 1 && mpz_sizeinbase(pool.pop()->get_mpz_t(), 2) == 256);
+    }
+    fs::remove(file);
+
+    // Twórca zginął przed zapisem nagłówka (wyzerowany plik): następny proces inicjalizuje pulę od nowa
+    {
+        std::ofstream(file, std::ios::binary) << std::string(100, '\0');
+        rsa::PrimePool pool(file, 256, 8);
+        assert(pool.capacity() == 8 && pool.size() == 0);
+        assert(fs::file_size(file) == 40 + 8 * 32);
+    }
+    fs::remove(file);
+
+    // `pool` kończy się, gdy dołoży brakujące liczby, nawet jeśli inny proces od razu je zdejmuje
+    {
+        const fs::path dir = fs::temp_directory_path() / ("rsa_test_pool_" + std::to_string(rsa::ChaCha20Drbg::thread_instance()()));
+        cli::pool_args_t args;
+        args.bits = 128;
+        args.dir = dir.string();
+        args.capacity = 4;
+        args.jobs = 1;
+
+        auto drain = cli::open_prime_pool(args.dir, args.bits, args.primes, 4);
+        std::jthread consumer([&](std::stop_token stop) {
+            while (!stop.stop_requested()) {
+                if (!drain->pop()) std::this_thread::yield();
+            }
+        });
+        assert(cli::cmd_fill_pool(args));
+        consumer.request_stop();
+        consumer.join();
+        drain.reset();
+        fs::remove_all(dir);
+    }
+}
+
+void UnitTests::test_thread_pool() {
+    rsa::ThreadPool pool(3);
+
+    // Każdy indeks dokładnie raz
+    std::vector<std::atomic<int>> hits(1000);
+    pool.run(hits.size(), [&](size_t i) { ++hits[i]; });
+    assert(std::all_of(hits.begin(), hits.end(), [](const std::atomic<int>& h) { return h == 1; }));
+
+    // Zagnieżdżone wywołania z wielu wątków naraz nie mogą się zakleszczyć
+    std::atomic<int> inner{ 0 };
+    pool.run(8, [&](size_t) { pool.run(8, [&](size_t) { ++inner; }); });
+    assert(inner == 64);
+
+    // Wyjątek z zadania wraca do wywołującego
+    bool thrown = false;
+    try {
+        pool.run(16, [](size_t i) { if (i == 7) throw std::runtime_error("task"); });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Rundy MR na puli dla dużych kandydatów: Mersenne 2^4253 - 1 (pierwsza) i iloczyn (złożony)
+    big_int m4253 = (big_int(1) << 4253) - 1;
+    assert(rsa.is_probable_prime(m4253, 8));
+    assert(!rsa.is_probable_prime(m4253 * ((big_int(1) << 607) - 1), 8));
+}
+
+void UnitTests::test_bulk_keygen() {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / ("rsa_test_bulk_" + std::to_string(rsa::ChaCha20Drbg::thread_instance()()));
+    constexpr size_t pairs = 4;
+
+    cli::genkeys_args_t args;
+    args.bits = 256;
+    args.count = static_cast<int>(pairs);
+    args.jobs = 2;
+    args.threads = 1;
+
+    auto read_pub = [](std::istream& is) {
+        rsa::PubKey pub;
+        is >> pub.e >> pub.n;
+        assert(is);
+        return pub;
+    };
+
+    // Kontener: linia klucza publicznego i linia prywatnego na parę, ten sam n w obu, n różne między parami
+    auto check_container = [&](std::istream& is) {
+        std::vector<big_int> moduli;
+        std::string pub_line, priv_line;
+        while (std::getline(is, pub_line) && std::getline(is, priv_line)) {
+            std::istringstream pub_is(pub_line), priv_is(priv_line);
+            const rsa::PubKey pub = read_pub(pub_is);
+            const rsa::PrivKey priv = cli::read_priv_key(priv_is);
+            assert(pub.n == priv.n && priv.has_crt());
+            moduli.push_back(pub.n);
+        }
+        assert(moduli.size() == pairs);
+        std::sort(moduli.begin(), moduli.end());
+        assert(std::adjacent_find(moduli.begin(), moduli.end()) == moduli.end());
+    };
+
+    // Krok jednej pary bez puli wątków
+    {
+        rsa::RSA engine;
+        std::mutex out_mutex;
+        std::stringstream container;
+        for (size_t i = 0; i < pairs; ++i) cli::generate_bulk_entry(engine, args, i, &container, out_mutex);
+        check_container(container);
+    }
+
+    // Pełna komenda z kontenerem
+    {
+        args.container = (dir / "all.keys").string();
+        fs::create_directories(dir);
+        assert(cli::cmd_generate_keys(args));
+        std::ifstream container(args.container);
+        check_container(container);
+        args.container.clear();
+    }
+
+    // Pełna komenda z katalogiem: para plików na indeks, klucz publiczny pasuje do prywatnego
+    {
+        args.out_dir = (dir / "keys").string();
+        assert(cli::cmd_generate_keys(args));
+        std::vector<big_int> moduli;
+        for (size_t i = 0; i < pairs; ++i) {
+            std::ifstream pub_file(cli::indexed_path(args.out_pub, i, args.out_dir));
+            std::ifstream priv_file(cli::indexed_path(args.out_priv, i, args.out_dir));
+            assert(pub_file && priv_file);
+            const rsa::PubKey pub = read_pub(pub_file);
+            const rsa::PrivKey priv = cli::read_priv_key(priv_file);
+            assert(pub.n == priv.n && mpz_sizeinbase(pub.n.get_mpz_t(), 2) == 256);
+            moduli.push_back(pub.n);
+        }
+        assert(!fs::exists(cli::indexed_path(args.out_pub, pairs, args.out_dir)));
+        std::sort(moduli.begin(), moduli.end());
+        assert(std::adjacent_find(moduli.begin(), moduli.end()) == moduli.end());
+    }
+
+    fs::remove_all(dir);
+}
+
 int main() {
     try {
         UnitTests unit_tests;
@@ -105,6 +946,54 @@ int main() {
         unit_tests.test_rsa_consistency();
         std::cout << "[UnitTests] [2/2] PASS RSA consistency checks" << '\n';
 
+        std::cout << "[UnitTests] Running prepared key checks..." << '\n';
+        unit_tests.test_prepared_keys();
+        std::cout << "[UnitTests] PASS prepared key checks" << '\n';
+
+        std::cout << "[UnitTests] Running block framing checks..." << '\n';
+        unit_tests.test_framing();
+        std::cout << "[UnitTests] PASS block framing checks" << '\n';
+
+        std::cout << "[UnitTests] Running cipher container checks..." << '\n';
+        unit_tests.test_cipher_container();
+        std::cout << "[UnitTests] PASS cipher container checks" << '\n';
+
+        std::cout << "[UnitTests] Running Montgomery arithmetic checks..." << '\n';
+        unit_tests.test_montgomery();
+        std::cout << "[UnitTests] PASS Montgomery arithmetic checks" << '\n';
+
+        std::cout << "[UnitTests] Running multi-buffer exponentiation checks..." << '\n';
+        unit_tests.test_multibuffer();
+        std::cout << "[UnitTests] PASS multi-buffer exponentiation checks" << '\n';
+
+        std::cout << "[UnitTests] Running prime sieve checks..." << '\n';
+        unit_tests.test_sieve();
+        std::cout << "[UnitTests] PASS prime sieve checks" << '\n';
+
+        std::cout << "[UnitTests] Running DRBG checks..." << '\n';
+        unit_tests.test_drbg();
+        std::cout << "[UnitTests] PASS DRBG checks" << '\n';
+
+        std::cout << "[UnitTests] Running primality test checks..." << '\n';
+        unit_tests.test_primality();
+        std::cout << "[UnitTests] PASS primality test checks" << '\n';
+
+        std::cout << "[UnitTests] Running prime pool checks..." << '\n';
+        unit_tests.test_prime_pool();
+        std::cout << "[UnitTests] PASS prime pool checks" << '\n';
+
+        std::cout << "[UnitTests] Running thread pool checks..." << '\n';
+        unit_tests.test_thread_pool();
+        std::cout << "[UnitTests] PASS thread pool checks" << '\n';
+
+        std::cout << "[UnitTests] Running bulk key generation checks..." << '\n';
+        unit_tests.test_bulk_keygen();
+        std::cout << "[UnitTests] PASS bulk key generation checks" << '\n';
+
+        std::cout << "[UnitTests] Running CRT decryption checks..." << '\n';
+        unit_tests.test_crt();
+        std::cout << "[UnitTests] PASS CRT decryption checks" << '\n';
+
         std::cout << "[UnitTests] ALL TESTS PASSED SUCCESSFULLY!" << '\n';
     } catch (const std::exception& e) {
         std::cout << "[UnitTests] FAIL exception: " << e.what() << '\n';
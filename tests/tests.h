@@ -7,6 +7,18 @@ class UnitTests {
         UnitTests();
         void test_math();
         void test_rsa_consistency();
+        void test_prepared_keys();
+        void test_framing();
+        void test_cipher_container();
+        void test_crt();
+        void test_montgomery();
+        void test_multibuffer();
+        void test_sieve();
+        void test_drbg();
+        void test_primality();
+        void test_prime_pool();
+        void test_thread_pool();
+        void test_bulk_keygen();
 
     private:
         rsa::RSA rsa;